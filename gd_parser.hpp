@@ -3,31 +3,431 @@
 #include "havoc.hpp"
 #include "peglib.h"
 
+#include <filesystem>
 #include <fstream>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <deque>
+#include <memory_resource>
+#include <mutex>
+#include <shared_mutex>
+#include <span>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
 #include <variant>
 
+#if !defined(GD_PARSER_NO_SIMD)
+#if defined(__AVX2__)
+#define GD_PARSER_SIMD_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GD_PARSER_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+#endif
+
+#if !defined(GD_PARSER_MAX_DEPTH)
+#define GD_PARSER_MAX_DEPTH 256
+#endif
+
+#if defined(_WIN32)
+// Keep the min/max macros and the rarely used parts of the Win32 API out of
+// every file that includes this header.
+#if !defined(NOMINMAX)
+#define NOMINMAX
+#define GD_PARSER_DEFINED_NOMINMAX
+#endif
+#if !defined(WIN32_LEAN_AND_MEAN)
+#define WIN32_LEAN_AND_MEAN
+#define GD_PARSER_DEFINED_WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#if defined(GD_PARSER_DEFINED_NOMINMAX)
+#undef NOMINMAX
+#undef GD_PARSER_DEFINED_NOMINMAX
+#endif
+#if defined(GD_PARSER_DEFINED_WIN32_LEAN_AND_MEAN)
+#undef WIN32_LEAN_AND_MEAN
+#undef GD_PARSER_DEFINED_WIN32_LEAN_AND_MEAN
+#endif
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace gd
 {
-	struct constructable;
-	struct value;
+	// How deeply brackets may nest, counting tag headers. Deeper input is a
+	// syntax error rather than a risk of exhausting the stack.
+	inline constexpr size_t max_depth = GD_PARSER_MAX_DEPTH;
+
+	static_assert(max_depth > 0);
+
+	template <typename Allocator>
+	struct basic_traits
+	{
+		using allocator_type = Allocator;
+
+		template <typename T>
+		using allocator_for = typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+
+		using string_type = std::basic_string<char, std::char_traits<char>, allocator_for<char>>;
+		using identifier_type = string_type;
+
+		template <typename T>
+		using vector = std::vector<T, allocator_for<T>>;
+
+		template <typename K, typename V>
+		using map = std::unordered_map<K, V, std::hash<K>, std::equal_to<K>, allocator_for<std::pair<const K, V>>>;
+	};
+
+	using default_traits = basic_traits<std::allocator<std::byte>>;
+
+	template <typename Allocator>
+	struct basic_view_traits : basic_traits<Allocator>
+	{
+		using string_type = std::string_view;
+		using identifier_type = std::string_view;
+	};
+
+	struct symbol
+	{
+		std::uint32_t id = std::numeric_limits<std::uint32_t>::max();
+
+		auto operator<=>(const symbol&) const = default;
+	};
+
+	// The unparsed source of a value skipped by gd::parse_lazy. It points into
+	// the input, which has to outlive it until it is materialized.
+	struct deferred
+	{
+		std::string_view source;
+	};
+
+	// Selects the tags and fields kept by gd::parse_filtered. An empty list
+	// selects everything, so a filter with only field names keeps every tag.
+	struct filter
+	{
+		std::vector<std::string_view> tags;
+		std::vector<std::string_view> fields;
+
+		bool selects_tag(std::string_view identifier) const
+		{
+			return tags.empty() || std::ranges::find(tags, identifier) != end(tags);
+		}
+
+		bool selects_field(std::string_view name) const
+		{
+			return fields.empty() || std::ranges::find(fields, name) != end(fields);
+		}
+	};
+
+	namespace detail
+	{
+		constexpr std::string_view well_known_symbols[] = {
+			"gd_scene",
+			"gd_resource",
+			"ext_resource",
+			"sub_resource",
+			"resource",
+			"node",
+			"connection",
+			"editable",
+			"type",
+			"uid",
+			"path",
+			"id",
+			"name",
+			"parent",
+			"script",
+			"format",
+			"load_steps",
+			"instance",
+			"groups",
+			"signal",
+			"from",
+			"to",
+			"method",
+			"flags",
+			"ExtResource",
+			"SubResource",
+			"NodePath",
+			"Vector2",
+			"Vector2i",
+			"Vector3",
+			"Vector3i",
+			"Rect2",
+			"Transform2D",
+			"Transform3D",
+			"Color",
+		};
+
+		constexpr gd::symbol well_known_symbol(std::string_view name)
+		{
+			for (std::uint32_t i = 0; i < std::size(well_known_symbols); i++)
+			{
+				if (well_known_symbols[i] == name)
+				{
+					return { i };
+				}
+			}
+
+			throw std::invalid_argument("not a well known symbol");
+		}
+	}
+
+	namespace symbols
+	{
+		inline constexpr auto gd_scene = detail::well_known_symbol("gd_scene");
+		inline constexpr auto gd_resource = detail::well_known_symbol("gd_resource");
+		inline constexpr auto ext_resource = detail::well_known_symbol("ext_resource");
+		inline constexpr auto sub_resource = detail::well_known_symbol("sub_resource");
+		inline constexpr auto resource = detail::well_known_symbol("resource");
+		inline constexpr auto node = detail::well_known_symbol("node");
+		inline constexpr auto connection = detail::well_known_symbol("connection");
+		inline constexpr auto editable = detail::well_known_symbol("editable");
+		inline constexpr auto type = detail::well_known_symbol("type");
+		inline constexpr auto uid = detail::well_known_symbol("uid");
+		inline constexpr auto path = detail::well_known_symbol("path");
+		inline constexpr auto id = detail::well_known_symbol("id");
+		inline constexpr auto name = detail::well_known_symbol("name");
+		inline constexpr auto parent = detail::well_known_symbol("parent");
+		inline constexpr auto script = detail::well_known_symbol("script");
+		inline constexpr auto format = detail::well_known_symbol("format");
+		inline constexpr auto load_steps = detail::well_known_symbol("load_steps");
+		inline constexpr auto instance = detail::well_known_symbol("instance");
+		inline constexpr auto groups = detail::well_known_symbol("groups");
+		inline constexpr auto signal = detail::well_known_symbol("signal");
+		inline constexpr auto from = detail::well_known_symbol("from");
+		inline constexpr auto to = detail::well_known_symbol("to");
+		inline constexpr auto method = detail::well_known_symbol("method");
+		inline constexpr auto flags = detail::well_known_symbol("flags");
+		inline constexpr auto ExtResource = detail::well_known_symbol("ExtResource");
+		inline constexpr auto SubResource = detail::well_known_symbol("SubResource");
+		inline constexpr auto NodePath = detail::well_known_symbol("NodePath");
+		inline constexpr auto Vector2 = detail::well_known_symbol("Vector2");
+		inline constexpr auto Vector2i = detail::well_known_symbol("Vector2i");
+		inline constexpr auto Vector3 = detail::well_known_symbol("Vector3");
+		inline constexpr auto Vector3i = detail::well_known_symbol("Vector3i");
+		inline constexpr auto Rect2 = detail::well_known_symbol("Rect2");
+		inline constexpr auto Transform2D = detail::well_known_symbol("Transform2D");
+		inline constexpr auto Transform3D = detail::well_known_symbol("Transform3D");
+		inline constexpr auto Color = detail::well_known_symbol("Color");
+	}
+
+	class symbol_table
+	{
+	public:
+		symbol_table()
+		{
+			for (auto name : detail::well_known_symbols)
+			{
+				insert(name);
+			}
+		}
+
+		symbol_table(const symbol_table&) = delete;
+		symbol_table& operator=(const symbol_table&) = delete;
+
+		gd::symbol intern(std::string_view name)
+		{
+			if (auto symbol = find(name))
+			{
+				return *symbol;
+			}
+
+			std::unique_lock lock(_mutex);
+
+			if (auto iterator = _symbols.find(name); iterator != end(_symbols))
+			{
+				return iterator->second;
+			}
+
+			return insert(name);
+		}
+
+		std::optional<gd::symbol> find(std::string_view name) const
+		{
+			std::shared_lock lock(_mutex);
+
+			if (auto iterator = _symbols.find(name); iterator != end(_symbols))
+			{
+				return iterator->second;
+			}
 
-	using dictionary_t = std::unordered_map<std::string, value>;
-	using array_t = std::vector<value>;
+			return {};
+		}
 
-	using value_t = havoc::one_of<constructable, dictionary_t, array_t, bool, std::string, float>;
+		std::string_view name(gd::symbol symbol) const
+		{
+			std::shared_lock lock(_mutex);
+
+			return _names.at(symbol.id);
+		}
+
+		size_t size() const
+		{
+			std::shared_lock lock(_mutex);
+
+			return _names.size();
+		}
+
+	private:
+		gd::symbol insert(std::string_view name)
+		{
+			gd::symbol symbol { static_cast<std::uint32_t>(_names.size()) };
+
+			_symbols.emplace(_names.emplace_back(name), symbol);
+
+			return symbol;
+		}
+
+		mutable std::shared_mutex _mutex;
+
+		std::deque<std::string> _names;
+		std::unordered_map<std::string_view, gd::symbol> _symbols;
+	};
+
+	template <typename Allocator>
+	struct basic_interned_traits : basic_traits<Allocator>
+	{
+		using identifier_type = gd::symbol;
+	};
+
+	template <typename Traits>
+	struct basic_constructable;
 
-	struct value : value_t
+	template <typename Traits>
+	struct basic_packed_array;
+
+	template <typename Traits>
+	struct basic_value;
+
+	template <typename Traits>
+	using basic_dictionary = typename Traits::template map<typename Traits::string_type, basic_value<Traits>>;
+
+	template <typename Traits>
+	using basic_array = typename Traits::template vector<basic_value<Traits>>;
+
+	template <typename Traits>
+	using basic_value_t = havoc::basic_one_of<typename Traits::allocator_type, basic_constructable<Traits>, basic_dictionary<Traits>, basic_array<Traits>, basic_packed_array<Traits>, bool, typename Traits::string_type, std::int64_t, double, gd::deferred>;
+
+	template <typename Traits>
+	struct basic_value : basic_value_t<Traits>
 	{
-		using value_t::one_of;
+		using value_t = basic_value_t<Traits>;
+
+		using value_t::value_t;
 		using value_t::operator=;
 	};
 
-	struct field
+	template <typename Traits>
+	struct basic_field
+	{
+		typename Traits::identifier_type name;
+		basic_value<Traits> value;
+	};
+
+	template <typename Traits>
+	struct basic_tag
+	{
+		typename Traits::identifier_type identifier;
+		typename Traits::template vector<basic_field<Traits>> fields;
+		typename Traits::template vector<basic_field<Traits>> assignments;
+	};
+
+	template <typename Traits>
+	struct basic_constructable
+	{
+		typename Traits::identifier_type identifier;
+		typename Traits::template vector<basic_value<Traits>> arguments;
+	};
+
+	template <typename Traits>
+	using basic_packed_elements = havoc::basic_one_of<typename Traits::allocator_type,
+		typename Traits::template vector<std::uint8_t>,
+		typename Traits::template vector<std::int32_t>,
+		typename Traits::template vector<std::int64_t>,
+		typename Traits::template vector<float>,
+		typename Traits::template vector<double>>;
+
+	// A PackedByteArray, PackedInt32Array, PackedFloat32Array, PackedVector2Array
+	// or similar constructable whose arguments are all numbers, stored as one
+	// contiguous buffer of the element type Godot uses for it. Vector and
+	// color arrays are flattened, so a PackedVector2Array holds two floats per
+	// element.
+	template <typename Traits>
+	struct basic_packed_array
+	{
+		typename Traits::identifier_type identifier;
+		basic_packed_elements<Traits> elements;
+	};
+
+	template <typename Traits>
+	struct basic_file
 	{
-		std::string name;
-		struct value value;
+		typename Traits::template vector<basic_tag<Traits>> tags;
 	};
 
+	using value_t = basic_value_t<default_traits>;
+	using value = basic_value<default_traits>;
+	using dictionary_t = basic_dictionary<default_traits>;
+	using array_t = basic_array<default_traits>;
+	using field = basic_field<default_traits>;
+	using tag = basic_tag<default_traits>;
+	using constructable = basic_constructable<default_traits>;
+	using packed_array = basic_packed_array<default_traits>;
+	using file = basic_file<default_traits>;
+
+	namespace pmr
+	{
+		using traits = basic_traits<std::pmr::polymorphic_allocator<std::byte>>;
+
+		using value_t = basic_value_t<traits>;
+		using value = basic_value<traits>;
+		using dictionary_t = basic_dictionary<traits>;
+		using array_t = basic_array<traits>;
+		using field = basic_field<traits>;
+		using tag = basic_tag<traits>;
+		using constructable = basic_constructable<traits>;
+		using packed_array = basic_packed_array<traits>;
+		using file = basic_file<traits>;
+	}
+
+	namespace view
+	{
+		using traits = basic_view_traits<std::allocator<std::byte>>;
+
+		using value_t = basic_value_t<traits>;
+		using value = basic_value<traits>;
+		using dictionary_t = basic_dictionary<traits>;
+		using array_t = basic_array<traits>;
+		using field = basic_field<traits>;
+		using tag = basic_tag<traits>;
+		using constructable = basic_constructable<traits>;
+		using packed_array = basic_packed_array<traits>;
+		using file = basic_file<traits>;
+	}
+
+	namespace interned
+	{
+		using traits = basic_interned_traits<std::allocator<std::byte>>;
+
+		using value_t = basic_value_t<traits>;
+		using value = basic_value<traits>;
+		using dictionary_t = basic_dictionary<traits>;
+		using array_t = basic_array<traits>;
+		using field = basic_field<traits>;
+		using tag = basic_tag<traits>;
+		using constructable = basic_constructable<traits>;
+		using packed_array = basic_packed_array<traits>;
+		using file = basic_file<traits>;
+	}
+
 	namespace detail
 	{
 		struct fields
@@ -39,27 +439,200 @@ namespace gd
 		{
 			std::vector<field> fields;
 		};
+
+		struct node_ref
+		{
+			size_t index;
+		};
+
+		// Typed storage for the results of the PEG actions. Only a node_ref crosses
+		// a rule boundary, which std::any keeps in its small buffer, so the nodes
+		// themselves are never boxed. Each action consumes its children from the
+		// top of the arena, so it behaves like a stack.
+		class node_arena
+		{
+		public:
+			using node = std::variant<std::string, bool, gd::value, gd::field, std::pair<std::string, gd::value>, gd::dictionary_t, gd::array_t, fields, assignments, gd::tag>;
+
+			static node_arena& of(std::any& context)
+			{
+				return *std::any_cast<node_arena*>(context);
+			}
+
+			template <typename T>
+			T take(std::any& value)
+			{
+				return std::move(std::get<T>(at(value)));
+			}
+
+			node& at(std::any& value)
+			{
+				return _nodes[std::any_cast<node_ref>(value).index];
+			}
+
+			// Stores the result of an action in place of its children, along with
+			// anything a failed alternative left above them.
+			template <typename T>
+			node_ref reduce(const peg::SemanticValues& values, T&& result)
+			{
+				for (auto& value : values)
+				{
+					if (auto ref = std::any_cast<node_ref>(&value))
+					{
+						_nodes.erase(begin(_nodes) + ref->index, end(_nodes));
+						break;
+					}
+				}
+
+				_nodes.emplace_back(std::in_place_type<std::remove_cvref_t<T>>, std::forward<T>(result));
+
+				return { _nodes.size() - 1 };
+			}
+
+		private:
+			std::vector<node> _nodes;
+		};
 	}
 
-	struct tag
+	class mapped_file
 	{
-		std::string identifier;
-		std::vector<field> fields;
-		std::vector<field> assignments;
-	};
+	public:
+		explicit mapped_file(const std::filesystem::path& path)
+		{
+#if defined(_WIN32)
+			auto file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
 
-	struct constructable
-	{
-		std::string identifier;
-		std::vector<value> arguments;
-	};
+			if (file == INVALID_HANDLE_VALUE)
+			{
+				throw std::system_error(GetLastError(), std::system_category(), path.string());
+			}
 
-	struct file
-	{
-		std::vector<tag> tags;
+			LARGE_INTEGER size;
+
+			if (!GetFileSizeEx(file, &size))
+			{
+				auto error = GetLastError();
+
+				CloseHandle(file);
+
+				throw std::system_error(error, std::system_category(), path.string());
+			}
+
+			if (size.QuadPart > 0)
+			{
+				auto mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+				if (mapping)
+				{
+					_data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+
+					CloseHandle(mapping);
+				}
+
+				if (!_data)
+				{
+					auto error = GetLastError();
+
+					CloseHandle(file);
+
+					throw std::system_error(error, std::system_category(), path.string());
+				}
+
+				_size = static_cast<size_t>(size.QuadPart);
+			}
+
+			CloseHandle(file);
+#else
+			auto descriptor = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+			if (descriptor < 0)
+			{
+				throw std::system_error(errno, std::generic_category(), path.string());
+			}
+
+			struct stat status;
+
+			if (fstat(descriptor, &status) < 0)
+			{
+				auto error = errno;
+
+				close(descriptor);
+
+				throw std::system_error(error, std::generic_category(), path.string());
+			}
+
+			if (status.st_size > 0)
+			{
+				auto data = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+
+				if (data == MAP_FAILED)
+				{
+					auto error = errno;
+
+					close(descriptor);
+
+					throw std::system_error(error, std::generic_category(), path.string());
+				}
+
+				_data = static_cast<const char*>(data);
+				_size = static_cast<size_t>(status.st_size);
+			}
+
+			close(descriptor);
+#endif
+		}
+
+		mapped_file(mapped_file&& other) noexcept
+			: _data(std::exchange(other._data, nullptr))
+			, _size(std::exchange(other._size, 0))
+		{
+		}
+
+		mapped_file(const mapped_file&) = delete;
+
+		~mapped_file()
+		{
+			unmap();
+		}
+
+		mapped_file& operator=(mapped_file&& other) noexcept
+		{
+			if (this != &other)
+			{
+				unmap();
+
+				_data = std::exchange(other._data, nullptr);
+				_size = std::exchange(other._size, 0);
+			}
+
+			return *this;
+		}
+
+		mapped_file& operator=(const mapped_file&) = delete;
+
+		std::string_view view() const
+		{
+			return { _data, _size };
+		}
+
+	private:
+		void unmap()
+		{
+			if (_data)
+			{
+#if defined(_WIN32)
+				UnmapViewOfFile(_data);
+#else
+				munmap(const_cast<char*>(_data), _size);
+#endif
+			}
+		}
+
+		const char* _data = nullptr;
+		size_t _size = 0;
 	};
 
-	inline gd::file parse(std::istream& stream)
+	namespace detail
 	{
 		constexpr auto grammar = R"(
 File <- Tag+
@@ -90,152 +663,3434 @@ List(T) <- (T (',' T)*)?
 %whitespace <- [ \t\n\r]*
     )";
 
-		peg::parser parser(grammar);
-
-		parser["File"] = [](peg::SemanticValues values) {
-			gd::file file;
-
-			std::ranges::transform(values, back_inserter(file.tags), [](auto value) {
-				return std::any_cast<gd::tag>(value);
-			});
+		inline bool is_whitespace(char c)
+		{
+			return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+		}
 
-			return file;
-		};
+		inline bool is_digit(char c)
+		{
+			return c >= '0' && c <= '9';
+		}
 
-		parser["Fields"] = [](peg::SemanticValues values) -> detail::fields {
-			detail::fields fields;
+		inline bool is_identifier(char c)
+		{
+			return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || is_digit(c) || c == '.' || c == ':' || c == '_' || c == '/';
+		}
 
-			std::transform(begin(values), end(values), back_inserter(fields.fields), [](auto value) {
-				return std::any_cast<gd::field>(value);
-			});
+		// Each returns the end of the run of its class of characters that starts
+		// at begin.
+		inline const char* whitespace_end(const char* begin, const char* end)
+		{
+			while (begin < end && is_whitespace(*begin))
+			{
+				begin++;
+			}
 
-			return fields;
-		};
+			return begin;
+		}
 
-		parser["Assignments"] = [](peg::SemanticValues values) -> detail::assignments {
-			detail::assignments assignments;
+		inline const char* digits_end(const char* begin, const char* end)
+		{
+			while (begin < end && is_digit(*begin))
+			{
+				begin++;
+			}
 
-			std::transform(begin(values), end(values), back_inserter(assignments.fields), [](auto value) {
-				return std::any_cast<gd::field>(value);
-			});
+			return begin;
+		}
 
-			return assignments;
-		};
+		inline const char* identifier_end(const char* begin, const char* end)
+		{
+			while (begin < end && is_identifier(*begin))
+			{
+				begin++;
+			}
 
-		parser["Tag"] = [](peg::SemanticValues values) {
-			gd::tag tag {
-				.identifier = std::any_cast<std::string>(values[0]),
-			};
+			return begin;
+		}
 
-			for (auto i = 1; i < values.size(); i++)
+		namespace simd
+		{
+#if defined(GD_PARSER_SIMD_AVX2)
+			struct block
 			{
-				if (auto fields = std::any_cast<detail::fields>(&values[i]))
+				static constexpr size_t size = 32;
+
+				static block load(const char* data)
 				{
-					tag.fields = std::move(fields->fields);
+					return { _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data)) };
 				}
 
-				if (auto assignments = std::any_cast<detail::assignments>(&values[i]))
+				std::uint32_t equal(char c) const
 				{
-					tag.assignments = std::move(assignments->fields);
+					return _mm256_movemask_epi8(_mm256_cmpeq_epi8(data, _mm256_set1_epi8(c)));
 				}
-			}
 
-			return tag;
-		};
+				__m256i data;
+			};
+#elif defined(GD_PARSER_SIMD_SSE2)
+			struct block
+			{
+				static constexpr size_t size = 16;
 
-		parser["Constructable"] = [](peg::SemanticValues values) -> gd::constructable {
-			std::vector<value> arguments(values.size() - 1);
+				static block load(const char* data)
+				{
+					return { _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)) };
+				}
 
-			std::transform(begin(values) + 1, end(values), begin(arguments), [](auto value) {
-				return std::any_cast<gd::value>(value);
-			});
+				std::uint32_t equal(char c) const
+				{
+					return _mm_movemask_epi8(_mm_cmpeq_epi8(data, _mm_set1_epi8(c)));
+				}
 
-			return {
-				.identifier = std::any_cast<std::string>(values[0]),
-				.arguments = std::move(arguments),
+				__m128i data;
 			};
-		};
+#endif
 
-		parser["Property"] = [](peg::SemanticValues values) {
-			return std::make_pair(std::any_cast<std::string>(values[0]), std::any_cast<gd::value>(values[1]));
-		};
+			// Returns the first quote, bracket, brace or parenthesis in [begin, end).
+			inline const char* find_structural(const char* begin, const char* end)
+			{
+#if defined(GD_PARSER_SIMD_AVX2) || defined(GD_PARSER_SIMD_SSE2)
+				for (; end - begin >= static_cast<std::ptrdiff_t>(block::size); begin += block::size)
+				{
+					auto chunk = block::load(begin);
 
-		parser["Dictionary"] = [](peg::SemanticValues values) {
-			std::unordered_map<std::string, gd::value> dictionary;
+					if (auto found = chunk.equal('"') | chunk.equal('(') | chunk.equal(')') | chunk.equal('[') | chunk.equal(']') | chunk.equal('{') | chunk.equal('}'))
+					{
+						return begin + std::countr_zero(found);
+					}
+				}
+#endif
+				for (; begin < end; begin++)
+				{
+					switch (*begin)
+					{
+					case '"':
+					case '(':
+					case ')':
+					case '[':
+					case ']':
+					case '{':
+					case '}':
+						return begin;
+					}
+				}
 
-			std::ranges::transform(values, inserter(dictionary, begin(dictionary)), [](auto value) {
-				return std::any_cast<std::pair<std::string, gd::value>>(value);
-			});
+				return end;
+			}
 
-			return dictionary;
-		};
+			// Returns the first '\n' in [begin, end) that is directly followed by '['.
+			inline const char* find_tag_start(const char* begin, const char* end)
+			{
+#if defined(GD_PARSER_SIMD_AVX2) || defined(GD_PARSER_SIMD_SSE2)
+				for (; end - begin > static_cast<std::ptrdiff_t>(block::size); begin += block::size)
+				{
+					if (auto found = block::load(begin).equal('\n') & block::load(begin + 1).equal('['))
+					{
+						return begin + std::countr_zero(found);
+					}
+				}
+#endif
+				for (; end - begin > 1; begin++)
+				{
+					if (begin[0] == '\n' && begin[1] == '[')
+					{
+						return begin;
+					}
+				}
 
-		parser["Array"] = [](peg::SemanticValues values) {
-			gd::array_t array(values.size());
+				return end;
+			}
+		}
 
-			std::ranges::transform(values, begin(array), [](auto value) {
-				return std::any_cast<gd::value>(value);
-			});
+		// Returns the position of the first bracket outside a string that nests
+		// deeper than gd::max_depth, or npos.
+		inline size_t find_excess_nesting(std::string_view input)
+		{
+			auto begin = input.data();
+			auto end = begin + input.size();
+			size_t depth = 0;
 
-			return array;
-		};
+			for (auto position = simd::find_structural(begin, end); position != end; position = simd::find_structural(position + 1, end))
+			{
+				switch (*position)
+				{
+				case '"':
+					position = std::find(position + 1, end, '"');
 
-		parser["Field"] = [](peg::SemanticValues values) -> gd::field {
-			return {
-				.name = std::any_cast<std::string>(values[0]),
-				.value = std::any_cast<gd::value>(values[1]),
-			};
+					if (position == end)
+					{
+						return std::string_view::npos;
+					}
+
+					break;
+				case '(':
+				case '[':
+				case '{':
+					if (++depth > max_depth)
+					{
+						return position - begin;
+					}
+
+					break;
+				default:
+					if (depth > 0)
+					{
+						depth--;
+					}
+				}
+			}
+
+			return std::string_view::npos;
+		}
+
+		inline void log_error(size_t line, size_t column, std::string_view message)
+		{
+			std::cerr << line << ":" << column << ": " << message << std::endl;
+		}
+
+		inline void report_error(std::string_view input, size_t position, std::string_view message)
+		{
+			size_t line = 1;
+			size_t column = 1;
+
+			for (auto c : input.substr(0, position))
+			{
+				if (c == '\n')
+				{
+					line++;
+					column = 1;
+				}
+				else
+				{
+					column++;
+				}
+			}
+
+			log_error(line, column, message);
+		}
+
+		// Integer tokens that fit in 64 bits are kept exact, everything else
+		// becomes a double.
+		auto convert_numeric(std::string_view token, auto consumer)
+		{
+			auto first = token.data();
+			auto last = first + token.size();
+
+			if (token.find_first_of(".e") == std::string_view::npos)
+			{
+				if (std::int64_t integer; std::from_chars(first, last, integer).ec == std::errc{})
+				{
+					return consumer(integer);
+				}
+			}
+
+			double real = 0;
+			std::from_chars(first, last, real);
+
+			return consumer(real);
+		}
+
+		template <typename Value>
+		void assign_numeric(Value& value, std::string_view token)
+		{
+			convert_numeric(token, [&](auto numeric) {
+				value = numeric;
+			});
+		}
+
+		// Written to the binary format as a single byte.
+		enum class packed_type : std::uint8_t
+		{
+			none,
+			bytes,
+			int32,
+			int64,
+			float32,
+			float64,
+		};
+
+		constexpr packed_type packed_type_of(std::string_view identifier)
+		{
+			if (!identifier.starts_with("Packed"))
+			{
+				return packed_type::none;
+			}
+
+			if (identifier == "PackedByteArray")
+			{
+				return packed_type::bytes;
+			}
+
+			if (identifier == "PackedInt32Array")
+			{
+				return packed_type::int32;
+			}
+
+			if (identifier == "PackedInt64Array")
+			{
+				return packed_type::int64;
+			}
+
+			if (identifier == "PackedFloat32Array" || identifier == "PackedVector2Array" || identifier == "PackedVector3Array" || identifier == "PackedVector4Array" || identifier == "PackedColorArray")
+			{
+				return packed_type::float32;
+			}
+
+			if (identifier == "PackedFloat64Array")
+			{
+				return packed_type::float64;
+			}
+
+			return packed_type::none;
+		}
+
+		// Calls function with a std::type_identity of the element type.
+		auto with_packed_type(packed_type type, auto function)
+		{
+			switch (type)
+			{
+			case packed_type::bytes:
+				return function(std::type_identity<std::uint8_t>{});
+			case packed_type::int32:
+				return function(std::type_identity<std::int32_t>{});
+			case packed_type::int64:
+				return function(std::type_identity<std::int64_t>{});
+			case packed_type::float32:
+				return function(std::type_identity<float>{});
+			default:
+				return function(std::type_identity<double>{});
+			}
+		}
+
+		// Integer element types only take integers that are in range, and float
+		// only takes doubles that are within its range or were already infinite
+		// or NaN, so that anything which would not survive the conversion stays
+		// a constructable.
+		template <typename T>
+		bool to_element(auto numeric, T& element)
+		{
+			if constexpr (std::is_integral_v<T>)
+			{
+				if constexpr (std::is_floating_point_v<decltype(numeric)>)
+				{
+					return false;
+				}
+				else if (!std::in_range<T>(numeric))
+				{
+					return false;
+				}
+			}
+			else if constexpr (std::is_same_v<T, float> && std::is_same_v<decltype(numeric), double>)
+			{
+				if (std::isfinite(numeric) && std::abs(numeric) > std::numeric_limits<float>::max())
+				{
+					return false;
+				}
+			}
+
+			element = static_cast<T>(numeric);
+
+			return true;
+		}
+
+		template <typename T, typename Value>
+		bool argument_to_element(const Value& value, T& element)
+		{
+			if (auto integer = value.template get_if<std::int64_t>())
+			{
+				return to_element(*integer, element);
+			}
+
+			if (auto real = value.template get_if<double>())
+			{
+				return to_element(*real, element);
+			}
+
+			return false;
+		}
+
+		template <typename Traits>
+		class descent_parser
+		{
+		public:
+			using allocator_type = typename Traits::allocator_type;
+			using string_type = typename Traits::string_type;
+			using identifier_type = typename Traits::identifier_type;
+			using value_type = basic_value<Traits>;
+			using dictionary_type = basic_dictionary<Traits>;
+			using array_type = basic_array<Traits>;
+			using field_type = basic_field<Traits>;
+			using tag_type = basic_tag<Traits>;
+			using constructable_type = basic_constructable<Traits>;
+			using packed_array_type = basic_packed_array<Traits>;
+			using file_type = basic_file<Traits>;
+
+			explicit descent_parser(std::string_view input, const allocator_type& allocator = {}, gd::symbol_table* symbols = nullptr)
+				: _input(input)
+				, _allocator(allocator)
+				, _symbols(symbols)
+			{
+			}
+
+			bool parse(file_type& file)
+			{
+				auto result = make_file();
+
+				if (!parse_tags([&](tag_type&& tag) {
+						result.tags.push_back(std::move(tag));
+					}))
+				{
+					return false;
+				}
+
+				file = std::move(result);
+
+				return true;
+			}
+
+			bool parse_value(value_type& value)
+			{
+				skip_whitespace();
+
+				if (!match_value(value) || _position < _input.size())
+				{
+					fail();
+
+					if (_logging)
+					{
+						report();
+					}
+
+					return false;
+				}
+
+				return true;
+			}
+
+			void disable_logging()
+			{
+				_logging = false;
+			}
+
+			size_t position() const
+			{
+				return _position;
+			}
+
+			// Field values whose source is longer than threshold are skipped and
+			// stored as gd::deferred instead of being parsed.
+			void defer_above(size_t threshold)
+			{
+				_defer = threshold;
+			}
+
+			// Tags and fields that the filter does not select are skipped without
+			// being stored. The filter has to outlive the parser.
+			void select(const gd::filter& filter)
+			{
+				_filter = &filter;
+			}
+
+			bool parse_tags(auto callback)
+			{
+				skip_whitespace();
+
+				auto tag = make_tag();
+				auto empty = true;
+
+				for (auto selected = true; match_tag(tag, selected);)
+				{
+					empty = false;
+
+					if (!selected)
+					{
+						continue;
+					}
+
+					if constexpr (std::is_same_v<std::invoke_result_t<decltype(callback), tag_type&&>, bool>)
+					{
+						if (!callback(std::move(tag)))
+						{
+							return true;
+						}
+					}
+					else
+					{
+						callback(std::move(tag));
+					}
+				}
+
+				if (empty || _position < _input.size())
+				{
+					fail();
+
+					if (_logging)
+					{
+						report();
+					}
+
+					return false;
+				}
+
+				return true;
+			}
+
+		private:
+			template <typename T>
+			T make() const
+			{
+				return std::make_obj_using_allocator<T>(_allocator);
+			}
+
+			field_type make_field() const
+			{
+				return {
+					.name = make<identifier_type>(),
+					.value = make<value_type>(),
+				};
+			}
+
+			tag_type make_tag() const
+			{
+				return {
+					.identifier = make<identifier_type>(),
+					.fields = make<typename Traits::template vector<field_type>>(),
+					.assignments = make<typename Traits::template vector<field_type>>(),
+				};
+			}
+
+			constructable_type make_constructable() const
+			{
+				return {
+					.identifier = make<identifier_type>(),
+					.arguments = make<typename Traits::template vector<value_type>>(),
+				};
+			}
+
+			packed_array_type make_packed_array() const
+			{
+				return {
+					.identifier = make<identifier_type>(),
+					.elements = make<basic_packed_elements<Traits>>(),
+				};
+			}
+
+			file_type make_file() const
+			{
+				return {
+					.tags = make<typename Traits::template vector<tag_type>>(),
+				};
+			}
+
+			bool at(char c) const
+			{
+				return _position < _input.size() && _input[_position] == c;
+			}
+
+			bool fail()
+			{
+				_error = std::max(_error, _position);
+
+				return false;
+			}
+
+			bool rewind(size_t position)
+			{
+				_position = position;
+
+				return false;
+			}
+
+			void report() const
+			{
+				report_error(_input, _error, _error == _too_deep ? "maximum nesting depth exceeded" : "syntax error");
+			}
+
+			// Holds one level of bracket nesting for as long as it lives.
+			struct nesting
+			{
+				explicit nesting(size_t& depth) :
+					depth(depth)
+				{
+					depth++;
+				}
+
+				~nesting()
+				{
+					depth--;
+				}
+
+				size_t& depth;
+			};
+
+			// Like match_literal, but fails on a bracket that nests deeper than
+			// gd::max_depth so that hostile input cannot exhaust the stack.
+			bool match_opening(char c)
+			{
+				if (_depth > max_depth && at(c))
+				{
+					_too_deep = _position;
+
+					return fail();
+				}
+
+				return match_literal(c);
+			}
+
+			void skip_whitespace()
+			{
+				if (_position < _input.size() && is_whitespace(_input[_position]))
+				{
+					_position = whitespace_end(_input.data() + _position + 1, _input.data() + _input.size()) - _input.data();
+				}
+			}
+
+			bool match_literal(char c)
+			{
+				if (!at(c))
+				{
+					return fail();
+				}
+
+				_position++;
+
+				skip_whitespace();
+
+				return true;
+			}
+
+			bool match_literal(std::string_view literal)
+			{
+				if (_input.substr(_position, literal.size()) != literal)
+				{
+					return fail();
+				}
+
+				_position += literal.size();
+
+				skip_whitespace();
+
+				return true;
+			}
+
+			bool scan_digits()
+			{
+				auto start = _position;
+
+				_position = digits_end(_input.data() + _position, _input.data() + _input.size()) - _input.data();
+
+				if (_position == start)
+				{
+					return fail();
+				}
+
+				return true;
+			}
+
+			bool scan_integer()
+			{
+				auto start = _position;
+
+				if (at('-'))
+				{
+					_position++;
+				}
+
+				if (!scan_digits())
+				{
+					return rewind(start);
+				}
+
+				return true;
+			}
+
+			bool scan_exponent()
+			{
+				auto start = _position;
+
+				if (!at('e'))
+				{
+					return fail();
+				}
+
+				_position++;
+
+				if (!scan_integer())
+				{
+					return rewind(start);
+				}
+
+				return true;
+			}
+
+			bool scan_numeric()
+			{
+				if (!scan_integer())
+				{
+					return false;
+				}
+
+				scan_exponent();
+
+				if (auto fraction = _position; at('.'))
+				{
+					_position++;
+
+					if (scan_digits())
+					{
+						scan_exponent();
+					}
+					else
+					{
+						rewind(fraction);
+					}
+				}
+
+				return true;
+			}
+
+			bool match_numeric(value_type& value)
+			{
+				auto start = _position;
+
+				if (!scan_numeric())
+				{
+					return false;
+				}
+
+				assign_numeric(value, _input.substr(start, _position - start));
+
+				skip_whitespace();
+
+				return true;
+			}
+
+			// Elements are scanned and converted one token at a time. About
+			// half of the time goes into from_chars, and the tokens are a few
+			// characters long, too short for a vectorised scan to pay off.
+			template <typename T>
+			bool match_element(T& element)
+			{
+				auto start = _position;
+
+				if (!scan_numeric() || !convert_numeric(_input.substr(start, _position - start), [&](auto numeric) { return to_element(numeric, element); }))
+				{
+					return rewind(start);
+				}
+
+				skip_whitespace();
+
+				return true;
+			}
+
+			std::string_view peek_identifier() const
+			{
+				auto end = identifier_end(_input.data() + _position, _input.data() + _input.size()) - _input.data();
+
+				return _input.substr(_position, end - _position);
+			}
+
+			bool match_identifier(identifier_type& identifier)
+			{
+				auto start = _position;
+
+				_position = identifier_end(_input.data() + _position, _input.data() + _input.size()) - _input.data();
+
+				if (_position == start)
+				{
+					return fail();
+				}
+
+				if constexpr (std::is_same_v<identifier_type, gd::symbol>)
+				{
+					identifier = intern(_input.substr(start, _position - start));
+				}
+				else
+				{
+					identifier = _input.substr(start, _position - start);
+				}
+
+				skip_whitespace();
+
+				return true;
+			}
+
+			gd::symbol intern(std::string_view name)
+			{
+				if (auto iterator = _interned.find(name); iterator != end(_interned))
+				{
+					return iterator->second;
+				}
+
+				return _interned[name] = _symbols->intern(name);
+			}
+
+			bool match_string(string_type& string)
+			{
+				auto start = _position;
+
+				if (at('&'))
+				{
+					match_literal('&');
+				}
+
+				if (!match_literal('"'))
+				{
+					return rewind(start);
+				}
+
+				auto end = _input.find('"', _position);
+
+				if (end == std::string_view::npos)
+				{
+					_position = _input.size();
+
+					fail();
+
+					return rewind(start);
+				}
+
+				string = _input.substr(_position, end - _position);
+
+				_position = end;
+
+				return match_literal('"');
+			}
+
+			bool match_boolean(bool& boolean)
+			{
+				if (_input.substr(_position).starts_with("true"))
+				{
+					boolean = true;
+
+					return match_literal("true");
+				}
+
+				if (_input.substr(_position).starts_with("false"))
+				{
+					boolean = false;
+
+					return match_literal("false");
+				}
+
+				return fail();
+			}
+
+			static void append(auto& list, auto&& element)
+			{
+				if constexpr (requires { list.push_back(std::move(element)); })
+				{
+					list.push_back(std::move(element));
+				}
+				else
+				{
+					list.insert(std::move(element));
+				}
+			}
+
+			template <typename T>
+			bool match_list(auto& list, auto match)
+			{
+				auto element = make<T>();
+
+				if (!(this->*match)(element))
+				{
+					return true;
+				}
+
+				append(list, std::move(element));
+
+				for (;;)
+				{
+					auto start = _position;
+
+					if (!match_literal(',') || !(this->*match)(element))
+					{
+						rewind(start);
+
+						return true;
+					}
+
+					append(list, std::move(element));
+				}
+			}
+
+			bool match_array(array_type& array)
+			{
+				auto start = _position;
+				auto nested = nesting(_depth);
+
+				if (!match_opening('[') || !match_list<value_type>(array, &descent_parser::match_value) || !match_literal(']'))
+				{
+					array.clear();
+
+					return rewind(start);
+				}
+
+				return true;
+			}
+
+			bool match_property(std::pair<string_type, value_type>& property)
+			{
+				auto start = _position;
+
+				if (!match_string(property.first) || !match_literal(':') || !match_value(property.second))
+				{
+					return rewind(start);
+				}
+
+				return true;
+			}
+
+			bool match_dictionary(dictionary_type& dictionary)
+			{
+				auto start = _position;
+				auto nested = nesting(_depth);
+
+				if (!match_opening('{') || !match_list<std::pair<string_type, value_type>>(dictionary, &descent_parser::match_property) || !match_literal('}'))
+				{
+					dictionary.clear();
+
+					return rewind(start);
+				}
+
+				return true;
+			}
+
+			bool match_constructable(constructable_type& constructable)
+			{
+				auto start = _position;
+				auto nested = nesting(_depth);
+
+				if (!match_identifier(constructable.identifier) || !match_opening('(') || !match_list<value_type>(constructable.arguments, &descent_parser::match_value) || !match_literal(')'))
+				{
+					constructable.arguments.clear();
+
+					return rewind(start);
+				}
+
+				return true;
+			}
+
+			bool match_packed_array(packed_array_type& packed)
+			{
+				auto start = _position;
+				auto type = packed_type_of(peek_identifier());
+
+				if (type == packed_type::none)
+				{
+					return false;
+				}
+
+				auto nested = nesting(_depth);
+
+				if (!match_identifier(packed.identifier) || !match_opening('('))
+				{
+					return rewind(start);
+				}
+
+				auto matched = with_packed_type(type, [&]<typename T>(std::type_identity<T>) {
+					auto elements = make<typename Traits::template vector<T>>();
+
+					if (!match_list<T>(elements, &descent_parser::match_element<T>) || !match_literal(')'))
+					{
+						return false;
+					}
+
+					packed.elements = std::move(elements);
+
+					return true;
+				});
+
+				if (!matched)
+				{
+					return rewind(start);
+				}
+
+				return true;
+			}
+
+			bool match_value(value_type& value)
+			{
+				if (match_numeric(value))
+				{
+					return true;
+				}
+
+				if (auto string = make<string_type>(); match_string(string))
+				{
+					value = std::move(string);
+				}
+				else if (auto packed = make_packed_array(); match_packed_array(packed))
+				{
+					value = std::move(packed);
+				}
+				else if (auto constructable = make_constructable(); match_constructable(constructable))
+				{
+					value = std::move(constructable);
+				}
+				else if (auto dictionary = make<dictionary_type>(); match_dictionary(dictionary))
+				{
+					value = std::move(dictionary);
+				}
+				else if (auto array = make<array_type>(); match_array(array))
+				{
+					value = std::move(array);
+				}
+				else if (bool boolean; match_boolean(boolean))
+				{
+					value = std::move(boolean);
+				}
+				else
+				{
+					return false;
+				}
+
+				return true;
+			}
+
+			// Finds the end of a string, array, dictionary or constructable by
+			// matching quotes and brackets only, without checking what is between
+			// them. Returns npos for any other value.
+			size_t scan_deferrable() const
+			{
+				auto begin = _input.data();
+				auto end = begin + _input.size();
+				auto position = _position;
+
+				if (position < _input.size() && _input[position] == '&')
+				{
+					position = whitespace_end(begin + position + 1, end) - begin;
+				}
+
+				if (position == _input.size())
+				{
+					return std::string_view::npos;
+				}
+
+				if (_input[position] == '"')
+				{
+					auto quote = _input.find('"', position + 1);
+
+					return quote == std::string_view::npos ? quote : quote + 1;
+				}
+
+				if (_input[position] != '[' && _input[position] != '{')
+				{
+					size_t identifier = identifier_end(begin + position, end) - begin;
+
+					if (identifier == position)
+					{
+						return std::string_view::npos;
+					}
+
+					position = whitespace_end(begin + identifier, end) - begin;
+
+					if (position == _input.size() || _input[position] != '(')
+					{
+						return std::string_view::npos;
+					}
+				}
+
+				for (size_t depth = 0;; position++)
+				{
+					position = simd::find_structural(begin + position, end) - begin;
+
+					if (position == _input.size())
+					{
+						return std::string_view::npos;
+					}
+
+					if (_input[position] == '"')
+					{
+						position = _input.find('"', position + 1);
+
+						if (position == std::string_view::npos)
+						{
+							return position;
+						}
+					}
+					else if (_input[position] == '(' || _input[position] == '[' || _input[position] == '{')
+					{
+						depth++;
+					}
+					else if (--depth == 0)
+					{
+						return position + 1;
+					}
+				}
+			}
+
+			bool match_deferred(value_type& value)
+			{
+				if (_defer == std::numeric_limits<size_t>::max())
+				{
+					return false;
+				}
+
+				auto end = scan_deferrable();
+
+				if (end == std::string_view::npos || end - _position <= _defer)
+				{
+					return false;
+				}
+
+				value = gd::deferred { _input.substr(_position, end - _position) };
+
+				_position = end;
+
+				skip_whitespace();
+
+				return true;
+			}
+
+			bool match_field(field_type& field)
+			{
+				auto start = _position;
+
+				if (!match_identifier(field.name) || !match_literal('=') || !(match_deferred(field.value) || match_value(field.value)))
+				{
+					return rewind(start);
+				}
+
+				return true;
+			}
+
+			// Skips a value without storing it. Only numbers are actually matched,
+			// everything else is skipped by matching quotes and brackets.
+			bool skip_value()
+			{
+				if (value_type numeric; match_numeric(numeric))
+				{
+					return true;
+				}
+
+				if (auto end = scan_deferrable(); end != std::string_view::npos)
+				{
+					_position = end;
+
+					skip_whitespace();
+
+					return true;
+				}
+
+				bool boolean;
+
+				return match_boolean(boolean);
+			}
+
+			bool skip_identifier()
+			{
+				auto identifier = peek_identifier();
+
+				if (identifier.empty())
+				{
+					return fail();
+				}
+
+				_position += identifier.size();
+
+				skip_whitespace();
+
+				return true;
+			}
+
+			bool skip_field()
+			{
+				auto start = _position;
+
+				if (!skip_identifier() || !match_literal('=') || !skip_value())
+				{
+					return rewind(start);
+				}
+
+				return true;
+			}
+
+			void match_fields(auto& fields, bool selected)
+			{
+				auto field = make_field();
+
+				for (;;)
+				{
+					if (selected && (!_filter || _filter->selects_field(peek_identifier())))
+					{
+						if (!match_field(field))
+						{
+							return;
+						}
+
+						fields.push_back(std::move(field));
+					}
+					else if (!skip_field())
+					{
+						return;
+					}
+				}
+			}
+
+			bool match_tag(tag_type& tag, bool& selected)
+			{
+				auto start = _position;
+
+				tag = make_tag();
+
+				{
+					auto nested = nesting(_depth);
+
+					if (!match_opening('['))
+					{
+						return rewind(start);
+					}
+
+					selected = !_filter || _filter->selects_tag(peek_identifier());
+
+					if (selected ? !match_identifier(tag.identifier) : !skip_identifier())
+					{
+						return rewind(start);
+					}
+
+					match_fields(tag.fields, selected);
+
+					if (!match_literal(']'))
+					{
+						return rewind(start);
+					}
+				}
+
+				match_fields(tag.assignments, selected);
+
+				return true;
+			}
+
+			std::string_view _input;
+
+			size_t _position = 0;
+			size_t _error = 0;
+			size_t _depth = 0;
+			size_t _too_deep = std::string_view::npos;
+
+			bool _logging = true;
+
+			size_t _defer = std::numeric_limits<size_t>::max();
+
+			const gd::filter* _filter = nullptr;
+
+			allocator_type _allocator;
+
+			gd::symbol_table* _symbols;
+
+			std::unordered_map<std::string_view, gd::symbol> _interned;
+		};
+
+		inline size_t thread_count(size_t threads)
+		{
+			return threads ? threads : std::max(std::thread::hardware_concurrency(), 1u);
+		}
+
+		// Runs function(index, worker) for every index in [0, count) on up to
+		// threads workers. Each worker owns a contiguous slice of the indices and
+		// steals from the back of the other workers' slices once its own runs out.
+		inline void parallel_for(size_t count, size_t threads, auto function)
+		{
+			struct alignas(64) queue
+			{
+				std::mutex mutex;
+				std::deque<size_t> indices;
+			};
+
+			threads = std::min(thread_count(threads), std::max<size_t>(count, 1));
+
+			std::vector<queue> queues(threads);
+			std::vector<std::exception_ptr> errors(count);
+
+			for (size_t i = 0; i < count; i++)
+			{
+				queues[i * threads / count].indices.push_back(i);
+			}
+
+			auto next = [&](size_t worker) -> std::optional<size_t> {
+				for (size_t i = 0; i < threads; i++)
+				{
+					auto& queue = queues[(worker + i) % threads];
+
+					std::lock_guard lock(queue.mutex);
+
+					if (queue.indices.empty())
+					{
+						continue;
+					}
+
+					size_t index;
+
+					if (i == 0)
+					{
+						index = queue.indices.front();
+						queue.indices.pop_front();
+					}
+					else
+					{
+						index = queue.indices.back();
+						queue.indices.pop_back();
+					}
+
+					return index;
+				}
+
+				return {};
+			};
+
+			auto work = [&](size_t worker) {
+				while (auto index = next(worker))
+				{
+					try
+					{
+						function(*index, worker);
+					}
+					catch (...)
+					{
+						errors[*index] = std::current_exception();
+					}
+				}
+			};
+
+			{
+				std::vector<std::jthread> workers;
+
+				for (size_t worker = 1; worker < threads; worker++)
+				{
+					workers.emplace_back(work, worker);
+				}
+
+				work(0);
+			}
+
+			for (auto& error : errors)
+			{
+				if (error)
+				{
+					std::rethrow_exception(error);
+				}
+			}
+		}
+	}
+
+	enum class backend
+	{
+		peg,
+		recursive_descent,
+	};
+
+	class parser
+	{
+	public:
+		parser()
+			: _parser(detail::grammar)
+		{
+			_parser["File"] = [](peg::SemanticValues& values, std::any& context) {
+				auto& arena = detail::node_arena::of(context);
+				gd::file file;
+
+				std::ranges::transform(values, back_inserter(file.tags), [&](auto& value) {
+					return arena.take<gd::tag>(value);
+				});
+
+				return file;
+			};
+
+			_parser["Fields"] = [](peg::SemanticValues& values, std::any& context) {
+				auto& arena = detail::node_arena::of(context);
+				detail::fields fields;
+
+				std::transform(begin(values), end(values), back_inserter(fields.fields), [&](auto& value) {
+					return arena.take<gd::field>(value);
+				});
+
+				return arena.reduce(values, std::move(fields));
+			};
+
+			_parser["Assignments"] = [](peg::SemanticValues& values, std::any& context) {
+				auto& arena = detail::node_arena::of(context);
+				detail::assignments assignments;
+
+				std::transform(begin(values), end(values), back_inserter(assignments.fields), [&](auto& value) {
+					return arena.take<gd::field>(value);
+				});
+
+				return arena.reduce(values, std::move(assignments));
+			};
+
+			_parser["Tag"] = [](peg::SemanticValues& values, std::any& context) {
+				auto& arena = detail::node_arena::of(context);
+				gd::tag tag {
+					.identifier = arena.take<std::string>(values[0]),
+				};
+
+				for (auto i = 1; i < values.size(); i++)
+				{
+					auto& node = arena.at(values[i]);
+
+					if (auto fields = std::get_if<detail::fields>(&node))
+					{
+						tag.fields = std::move(fields->fields);
+					}
+
+					if (auto assignments = std::get_if<detail::assignments>(&node))
+					{
+						tag.assignments = std::move(assignments->fields);
+					}
+				}
+
+				return arena.reduce(values, std::move(tag));
+			};
+
+			_parser["Constructable"] = [](peg::SemanticValues& values, std::any& context) {
+				auto& arena = detail::node_arena::of(context);
+				std::vector<value> arguments(values.size() - 1);
+
+				std::transform(begin(values) + 1, end(values), begin(arguments), [&](auto& value) {
+					return arena.take<gd::value>(value);
+				});
+
+				auto identifier = arena.take<std::string>(values[0]);
+
+				if (auto type = detail::packed_type_of(identifier); type != detail::packed_type::none)
+				{
+					gd::packed_array packed;
+
+					auto matched = detail::with_packed_type(type, [&]<typename T>(std::type_identity<T>) {
+						std::vector<T> elements(arguments.size());
+
+						for (size_t i = 0; i < arguments.size(); i++)
+						{
+							if (!detail::argument_to_element(arguments[i], elements[i]))
+							{
+								return false;
+							}
+						}
+
+						packed.elements = std::move(elements);
+
+						return true;
+					});
+
+					if (matched)
+					{
+						packed.identifier = std::move(identifier);
+
+						return arena.reduce(values, gd::value(std::move(packed)));
+					}
+				}
+
+				return arena.reduce(values, gd::value(gd::constructable {
+					.identifier = std::move(identifier),
+					.arguments = std::move(arguments),
+				}));
+			};
+
+			_parser["Property"] = [](peg::SemanticValues& values, std::any& context) {
+				auto& arena = detail::node_arena::of(context);
+				auto name = arena.take<std::string>(values[0]);
+
+				return arena.reduce(values, std::make_pair(std::move(name), arena.take<gd::value>(values[1])));
+			};
+
+			_parser["Dictionary"] = [](peg::SemanticValues& values, std::any& context) {
+				auto& arena = detail::node_arena::of(context);
+				gd::dictionary_t dictionary;
+
+				std::ranges::transform(values, inserter(dictionary, begin(dictionary)), [&](auto& value) {
+					return arena.take<std::pair<std::string, gd::value>>(value);
+				});
+
+				return arena.reduce(values, std::move(dictionary));
+			};
+
+			_parser["Array"] = [](peg::SemanticValues& values, std::any& context) {
+				auto& arena = detail::node_arena::of(context);
+				gd::array_t array(values.size());
+
+				std::ranges::transform(values, begin(array), [&](auto& value) {
+					return arena.take<gd::value>(value);
+				});
+
+				return arena.reduce(values, std::move(array));
+			};
+
+			_parser["Field"] = [](peg::SemanticValues& values, std::any& context) {
+				auto& arena = detail::node_arena::of(context);
+				gd::field field {
+					.name = arena.take<std::string>(values[0]),
+					.value = arena.take<gd::value>(values[1]),
+				};
+
+				return arena.reduce(values, std::move(field));
+			};
+
+			_parser["String"] = [](peg::SemanticValues& values, std::any& context) {
+				return detail::node_arena::of(context).reduce(values, values.token_to_string());
+			};
+
+			_parser["Identifier"] = [](peg::SemanticValues& values, std::any& context) {
+				return detail::node_arena::of(context).reduce(values, values.token_to_string());
+			};
+
+			_parser["Boolean"] = [](peg::SemanticValues& values, std::any& context) {
+				return detail::node_arena::of(context).reduce(values, values.token_to_string() == "true");
+			};
+
+			_parser["Numeric"] = [](peg::SemanticValues& values, std::any& context) {
+				gd::value value;
+				detail::assign_numeric(value, values.token());
+				return detail::node_arena::of(context).reduce(values, std::move(value));
+			};
+
+			_parser["Value"] = [](peg::SemanticValues& values, std::any& context) {
+				auto& arena = detail::node_arena::of(context);
+				gd::value value;
+
+				switch (values.choice())
+				{
+				case 0:
+					value = arena.take<gd::value>(values[0]);
+					break;
+				case 1:
+					value = arena.take<std::string>(values[0]);
+					break;
+				case 2:
+					value = arena.take<gd::value>(values[0]);
+					break;
+				case 3:
+					value = arena.take<gd::dictionary_t>(values[0]);
+					break;
+				case 4:
+					value = arena.take<gd::array_t>(values[0]);
+					break;
+				case 5:
+					value = arena.take<bool>(values[0]);
+					break;
+				}
+
+				return arena.reduce(values, std::move(value));
+			};
+
+			_parser.enable_choice_dispatch();
+
+			_parser.set_logger([](auto line, auto column, auto message) {
+				detail::log_error(line, column, message);
+			});
+		}
+
+		gd::file parse(std::string_view input, gd::backend backend = gd::backend::peg) const
+		{
+			gd::file file;
+
+			input = input.substr(0, input.find('\0'));
+
+			switch (backend)
+			{
+			case gd::backend::peg:
+			{
+				// The grammar recurses once per bracket, so overly deep input is
+				// rejected before it can exhaust the stack.
+				if (auto position = detail::find_excess_nesting(input); position != std::string_view::npos)
+				{
+					reject_nesting(input, position);
+					break;
+				}
+
+				detail::node_arena arena;
+				std::any context = &arena;
+
+				_parser.parse(input, context, file);
+				break;
+			}
+			case gd::backend::recursive_descent:
+				detail::descent_parser<default_traits>(input).parse(file);
+				break;
+			}
+
+			return file;
+		}
+
+		gd::file parse(std::istream& stream, gd::backend backend = gd::backend::peg) const
+		{
+			std::string str(std::istreambuf_iterator<char>(stream), {});
+
+			return parse(std::string_view(str), backend);
+		}
+
+		gd::file parse_file(const std::filesystem::path& path, gd::backend backend = gd::backend::peg) const
+		{
+			gd::mapped_file mapping(path);
+
+			return parse(mapping.view(), backend);
+		}
+
+	private:
+		// Parses the input up to and including the bracket that nests too
+		// deeply. Unless the parse fails before it gets past that bracket, the
+		// nesting is what gets reported, like in the recursive descent backend.
+		void reject_nesting(std::string_view input, size_t position) const
+		{
+			detail::node_arena arena;
+			std::any context = &arena;
+
+			auto result = _parser["File"].parse(input.data(), position + 1, context, nullptr, [](auto...) {});
+			auto& error = result.error_info;
+			auto failure = error.message_pos ? error.message_pos : error.error_pos;
+
+			if (!result.ret && failure && failure <= input.data() + position)
+			{
+				error.output_log([](auto line, auto column, auto message, auto) {
+					detail::log_error(line, column, message);
+				}, input.data(), input.size());
+			}
+			else
+			{
+				detail::report_error(input, position, "maximum nesting depth exceeded");
+			}
+		}
+
+		peg::parser _parser;
+	};
+
+	inline const parser& default_parser()
+	{
+		static const parser instance;
+
+		return instance;
+	}
+
+	inline gd::file parse(std::string_view input, gd::backend backend = gd::backend::peg)
+	{
+		return default_parser().parse(input, backend);
+	}
+
+	inline gd::file parse(std::istream& stream, gd::backend backend = gd::backend::peg)
+	{
+		return default_parser().parse(stream, backend);
+	}
+
+	inline gd::file parse_file(const std::filesystem::path& path, gd::backend backend = gd::backend::peg)
+	{
+		return default_parser().parse_file(path, backend);
+	}
+
+	inline std::vector<gd::file> parse_many(std::span<const std::filesystem::path> paths, gd::backend backend = gd::backend::peg, size_t threads = 0)
+	{
+		std::vector<gd::file> files(paths.size());
+
+		detail::parallel_for(paths.size(), threads, [&](size_t index, size_t) {
+			files[index] = parse_file(paths[index], backend);
+		});
+
+		return files;
+	}
+
+	inline bool is_resource_file(const std::filesystem::path& path)
+	{
+		auto extension = path.extension();
+
+		return extension == ".tscn" || extension == ".tres" || extension == ".godot";
+	}
+
+	inline std::vector<std::filesystem::path> find_resource_files(const std::filesystem::path& root)
+	{
+		std::vector<std::filesystem::path> paths;
+
+		for (const auto& entry : std::filesystem::recursive_directory_iterator(root))
+		{
+			if (entry.is_regular_file() && is_resource_file(entry.path()))
+			{
+				paths.push_back(entry.path());
+			}
+		}
+
+		std::ranges::sort(paths);
+
+		return paths;
+	}
+
+	inline std::vector<std::pair<std::filesystem::path, gd::file>> parse_project(const std::filesystem::path& root, gd::backend backend = gd::backend::peg, size_t threads = 0)
+	{
+		auto paths = find_resource_files(root);
+		auto files = parse_many(paths, backend, threads);
+
+		std::vector<std::pair<std::filesystem::path, gd::file>> project;
+
+		for (size_t i = 0; i < paths.size(); i++)
+		{
+			project.emplace_back(std::move(paths[i]), std::move(files[i]));
+		}
+
+		return project;
+	}
+
+	template <typename Traits>
+	basic_file<Traits> parse(std::string_view input, const typename Traits::allocator_type& allocator = {})
+	{
+		static_assert(!std::is_same_v<typename Traits::identifier_type, gd::symbol>, "Interned traits need a gd::symbol_table");
+
+		basic_file<Traits> file {
+			.tags = typename Traits::template vector<basic_tag<Traits>>(allocator),
+		};
+
+		detail::descent_parser<Traits>(input.substr(0, input.find('\0')), allocator).parse(file);
+
+		return file;
+	}
+
+	template <typename Traits>
+	basic_file<Traits> parse(std::string_view input, gd::symbol_table& symbols, const typename Traits::allocator_type& allocator = {})
+	{
+		basic_file<Traits> file {
+			.tags = typename Traits::template vector<basic_tag<Traits>>(allocator),
+		};
+
+		detail::descent_parser<Traits>(input.substr(0, input.find('\0')), allocator, &symbols).parse(file);
+
+		return file;
+	}
+
+	// Parses like gd::parse, except that field values whose source is longer
+	// than threshold bytes are only skipped over and stored as gd::deferred
+	// ranges of the input. Skipping only matches quotes and brackets, so syntax
+	// errors inside a deferred value surface when it is materialized.
+	template <typename Traits = default_traits>
+	basic_file<Traits> parse_lazy(std::string_view input, size_t threshold = 4096, const typename Traits::allocator_type& allocator = {})
+	{
+		static_assert(!std::is_same_v<typename Traits::identifier_type, gd::symbol>, "Interned traits need a gd::symbol_table");
+
+		basic_file<Traits> file {
+			.tags = typename Traits::template vector<basic_tag<Traits>>(allocator),
+		};
+
+		detail::descent_parser<Traits> parser(input.substr(0, input.find('\0')), allocator);
+		parser.defer_above(threshold);
+		parser.parse(file);
+
+		return file;
+	}
+
+	template <typename Traits>
+	basic_file<Traits> parse_lazy(std::string_view input, gd::symbol_table& symbols, size_t threshold = 4096, const typename Traits::allocator_type& allocator = {})
+	{
+		basic_file<Traits> file {
+			.tags = typename Traits::template vector<basic_tag<Traits>>(allocator),
+		};
+
+		detail::descent_parser<Traits> parser(input.substr(0, input.find('\0')), allocator, &symbols);
+		parser.defer_above(threshold);
+		parser.parse(file);
+
+		return file;
+	}
+
+	// Parses like gd::parse, but only keeps the tags and fields selected by
+	// the filter. Everything else is skipped by matching quotes and brackets
+	// and is never allocated, so syntax errors inside it may go unnoticed.
+	template <typename Traits = default_traits>
+	basic_file<Traits> parse_filtered(std::string_view input, const gd::filter& filter, const typename Traits::allocator_type& allocator = {})
+	{
+		static_assert(!std::is_same_v<typename Traits::identifier_type, gd::symbol>, "Interned traits need a gd::symbol_table");
+
+		basic_file<Traits> file {
+			.tags = typename Traits::template vector<basic_tag<Traits>>(allocator),
+		};
+
+		detail::descent_parser<Traits> parser(input.substr(0, input.find('\0')), allocator);
+		parser.select(filter);
+		parser.parse(file);
+
+		return file;
+	}
+
+	template <typename Traits>
+	basic_file<Traits> parse_filtered(std::string_view input, gd::symbol_table& symbols, const gd::filter& filter, const typename Traits::allocator_type& allocator = {})
+	{
+		basic_file<Traits> file {
+			.tags = typename Traits::template vector<basic_tag<Traits>>(allocator),
+		};
+
+		detail::descent_parser<Traits> parser(input.substr(0, input.find('\0')), allocator, &symbols);
+		parser.select(filter);
+		parser.parse(file);
+
+		return file;
+	}
+
+	inline std::vector<gd::file> parse_many_filtered(std::span<const std::filesystem::path> paths, const gd::filter& filter, size_t threads = 0)
+	{
+		std::vector<gd::file> files(paths.size());
+
+		detail::parallel_for(paths.size(), threads, [&](size_t index, size_t) {
+			gd::mapped_file mapping(paths[index]);
+
+			files[index] = parse_filtered(mapping.view(), filter);
+		});
+
+		return files;
+	}
+
+	inline std::vector<std::pair<std::filesystem::path, gd::file>> parse_project_filtered(const std::filesystem::path& root, const gd::filter& filter, size_t threads = 0)
+	{
+		auto paths = find_resource_files(root);
+		auto files = parse_many_filtered(paths, filter, threads);
+
+		std::vector<std::pair<std::filesystem::path, gd::file>> project;
+
+		for (size_t i = 0; i < paths.size(); i++)
+		{
+			project.emplace_back(std::move(paths[i]), std::move(files[i]));
+		}
+
+		return project;
+	}
+
+	namespace detail
+	{
+		template <typename Traits>
+		basic_value<Traits>& materialize(basic_value<Traits>& value, gd::symbol_table* symbols)
+		{
+			if (auto deferred = value.template get_if<gd::deferred>())
+			{
+				auto result = std::make_obj_using_allocator<basic_value<Traits>>(value.get_allocator());
+
+				descent_parser<Traits> parser(deferred->source, value.get_allocator(), symbols);
+				parser.disable_logging();
+
+				if (!parser.parse_value(result))
+				{
+					throw std::invalid_argument("deferred value is not valid");
+				}
+
+				value = std::move(result);
+			}
+
+			return value;
+		}
+	}
+
+	// Parses a gd::deferred value in place, using the allocator of the value.
+	// Anything else is returned untouched. Throws std::invalid_argument if the
+	// deferred source is not a valid value.
+	template <typename Traits>
+	basic_value<Traits>& materialize(basic_value<Traits>& value)
+	{
+		static_assert(!std::is_same_v<typename Traits::identifier_type, gd::symbol>, "Interned traits need a gd::symbol_table");
+
+		return detail::materialize(value, nullptr);
+	}
+
+	template <typename Traits>
+	basic_value<Traits>& materialize(basic_value<Traits>& value, gd::symbol_table& symbols)
+	{
+		return detail::materialize(value, &symbols);
+	}
+
+	// Splits the input in front of lines starting with '[' and parses the
+	// pieces concurrently. A split that falls inside a value leaves the piece
+	// before it unterminated, so such pieces fail to parse on their own and are
+	// merged with their successor and parsed again. The allocator is shared
+	// between threads and must be safe to use concurrently.
+	template <typename Traits = default_traits>
+	basic_file<Traits> parse_parallel(std::string_view input, size_t threads = 0, const typename Traits::allocator_type& allocator = {})
+	{
+		static_assert(!std::is_same_v<typename Traits::identifier_type, gd::symbol>, "Interned traits need a gd::symbol_table");
+
+		using file_type = basic_file<Traits>;
+
+		input = input.substr(0, input.find('\0'));
+		threads = detail::thread_count(threads);
+
+		auto make_file = [&] {
+			return file_type {
+				.tags = typename Traits::template vector<basic_tag<Traits>>(allocator),
+			};
+		};
+
+		auto parse_chunk = [&](std::string_view chunk, file_type& file) {
+			detail::descent_parser<Traits> parser(chunk, allocator);
+
+			parser.disable_logging();
+
+			return parser.parse(file);
+		};
+
+		std::vector<size_t> boundaries { 0 };
+
+		for (size_t i = 1, count = threads * 4; i < count; i++)
+		{
+			auto from = input.data() + std::max(boundaries.back(), input.size() * i / count);
+			auto position = detail::simd::find_tag_start(from, input.data() + input.size());
+
+			if (position == input.data() + input.size())
+			{
+				break;
+			}
+
+			boundaries.push_back(position - input.data() + 1);
+		}
+
+		boundaries.push_back(input.size());
+
+		auto chunks = boundaries.size() - 1;
+
+		std::vector<file_type> files;
+		std::vector<char> parsed(chunks);
+
+		for (size_t i = 0; i < chunks; i++)
+		{
+			files.push_back(make_file());
+		}
+
+		detail::parallel_for(chunks, threads, [&](size_t index, size_t) {
+			parsed[index] = parse_chunk(input.substr(boundaries[index], boundaries[index + 1] - boundaries[index]), files[index]);
+		});
+
+		auto result = make_file();
+
+		for (size_t first = 0, last = 0; first < chunks; first = ++last)
+		{
+			while (!parsed[first])
+			{
+				if (++last == chunks)
+				{
+					return parse<Traits>(input, allocator);
+				}
+
+				files[first] = make_file();
+				parsed[first] = parse_chunk(input.substr(boundaries[first], boundaries[last + 1] - boundaries[first]), files[first]);
+			}
+
+			for (auto& tag : files[first].tags)
+			{
+				result.tags.push_back(std::move(tag));
+			}
+		}
+
+		return result;
+	}
+
+	template <typename Traits = default_traits, typename Callback>
+	bool parse_tags(std::string_view input, Callback callback, const typename Traits::allocator_type& allocator = {})
+	{
+		static_assert(!std::is_same_v<typename Traits::identifier_type, gd::symbol>, "Interned traits need a gd::symbol_table");
+
+		return detail::descent_parser<Traits>(input.substr(0, input.find('\0')), allocator).parse_tags(std::move(callback));
+	}
+
+	template <typename Traits, typename Callback>
+	bool parse_tags(std::string_view input, gd::symbol_table& symbols, Callback callback, const typename Traits::allocator_type& allocator = {})
+	{
+		return detail::descent_parser<Traits>(input.substr(0, input.find('\0')), allocator, &symbols).parse_tags(std::move(callback));
+	}
+
+	template <typename Traits = default_traits, typename Callback>
+	bool parse_tags_file(const std::filesystem::path& path, Callback callback, const typename Traits::allocator_type& allocator = {})
+	{
+		gd::mapped_file mapping(path);
+
+		return parse_tags<Traits>(mapping.view(), std::move(callback), allocator);
+	}
+
+	// Keeps the source of a file next to its parsed tags and the offsets they
+	// were parsed from, so that an edit only reparses the tags it touches.
+	class incremental_file
+	{
+	public:
+		explicit incremental_file(std::string source)
+			: _source(std::move(source))
+		{
+			parse();
+		}
+
+		const gd::file& file() const
+		{
+			return _file;
+		}
+
+		std::string_view source() const
+		{
+			return _source;
+		}
+
+		// Replaces length bytes at offset with replacement, like
+		// std::string::replace, and reparses the tags around the edit. Returns
+		// whether the edited source is valid. If it is not, file() is empty,
+		// just like after gd::parse.
+		bool edit(size_t offset, size_t length, std::string_view replacement)
+		{
+			if (offset > _source.size())
+			{
+				throw std::out_of_range("edit is outside of the source");
+			}
+
+			length = std::min(length, _source.size() - offset);
+
+			auto tags = _file.tags.size();
+			auto complete = _offsets.back() == _source.size();
+
+			_source.replace(offset, length, replacement);
+
+			// Without tags there is nothing to splice into, and a '\0' anywhere
+			// changes where the input is truncated.
+			if (!tags || !complete || replacement.find('\0') != std::string_view::npos)
+			{
+				return parse();
+			}
+
+			// Tag i was parsed from [_offsets[i], _offsets[i + 1]), including the
+			// whitespace that follows it. An edit at the very start of a tag may
+			// also belong to the end of the previous one.
+			size_t first = std::upper_bound(begin(_offsets), end(_offsets) - 1, offset) - begin(_offsets) - 1;
+			size_t last = std::lower_bound(begin(_offsets) + 1, end(_offsets), offset + length) - begin(_offsets) - 1;
+
+			if (first > 0 && _offsets[first] == offset)
+			{
+				first--;
+			}
+
+			last = std::max(first, last);
+
+			auto delta = static_cast<std::ptrdiff_t>(replacement.size()) - static_cast<std::ptrdiff_t>(length);
+			auto start = _offsets[first];
+			auto chunk = std::string_view(_source).substr(start, _offsets[last + 1] + delta - start);
+
+			std::vector<gd::tag> parsed;
+			std::vector<size_t> ends;
+
+			if (detail::whitespace_end(chunk.data(), chunk.data() + chunk.size()) != chunk.data() + chunk.size())
+			{
+				detail::descent_parser<default_traits> parser(chunk);
+				parser.disable_logging();
+
+				auto valid = parser.parse_tags([&](gd::tag&& tag) {
+					parsed.push_back(std::move(tag));
+					ends.push_back(start + parser.position());
+				});
+
+				if (!valid)
+				{
+					return parse();
+				}
+			}
+			else if (last - first + 1 == tags)
+			{
+				return parse();
+			}
+
+			if (parsed.size() == last - first + 1)
+			{
+				std::ranges::move(parsed, begin(_file.tags) + first);
+			}
+			else
+			{
+				_file.tags.erase(begin(_file.tags) + first, begin(_file.tags) + last + 1);
+				_file.tags.insert(begin(_file.tags) + first, std::make_move_iterator(begin(parsed)), std::make_move_iterator(end(parsed)));
+			}
+
+			auto shifted = _offsets.erase(begin(_offsets) + first + 1, begin(_offsets) + last + 2);
+
+			for (auto iterator = shifted; iterator != end(_offsets); iterator++)
+			{
+				*iterator += delta;
+			}
+
+			_offsets.insert(shifted, begin(ends), end(ends));
+
+			return true;
+		}
+
+	private:
+		bool parse()
+		{
+			auto input = std::string_view(_source).substr(0, _source.find('\0'));
+
+			_file = {};
+			_offsets = { 0 };
+
+			detail::descent_parser<default_traits> parser(input);
+
+			auto valid = parser.parse_tags([&](gd::tag&& tag) {
+				_file.tags.push_back(std::move(tag));
+				_offsets.push_back(parser.position());
+			});
+
+			if (!valid)
+			{
+				_file = {};
+				_offsets = { 0 };
+			}
+
+			return valid;
+		}
+
+		std::string _source;
+
+		gd::file _file;
+
+		std::vector<size_t> _offsets;
+	};
+
+	namespace binary
+	{
+		enum class kind : std::uint8_t
+		{
+			constructable,
+			dictionary,
+			array,
+			packed_array,
+			boolean,
+			string,
+			integer,
+			real,
+		};
+	}
+
+	namespace detail
+	{
+		// Layout of the binary format. All integers are in host byte order.
+		//
+		// file:   "GDBF" u32:version u32:count tag...
+		// tag:    u32:size string:identifier list:fields list:assignments
+		// field:  string:name value
+		// list:   u32:count u32:size element...
+		// string: u32:size char...
+		// value:  u8:kind, followed by
+		//         constructable: string:identifier list:arguments
+		//         dictionary:    list of string:key value
+		//         array:         list of value
+		//         packed_array:  string:identifier u8:packed_type u32:count padding element...
+		//         boolean:       u8
+		//         string:        string
+		//         integer:       i64
+		//         real:          f64
+		//
+		// Sizes count the bytes that follow them, so that a reader can skip a tag
+		// or a list without decoding it. Packed elements are aligned to their
+		// size relative to the start of the data.
+		namespace binary
+		{
+			constexpr std::string_view magic = "GDBF";
+
+			// Bump whenever the layout or the parse result for some input changes,
+			// which also invalidates every gd::parse_cache entry.
+			constexpr std::uint32_t version = 3;
+
+			using gd::binary::kind;
+
+			template <typename Traits>
+			class writer
+			{
+			public:
+				using result = void;
+
+				explicit writer(std::string& output)
+					: _output(output)
+				{
+				}
+
+				void write_file(const basic_file<Traits>& file)
+				{
+					_output.append(magic);
+
+					write(version);
+					write_count(file.tags.size());
+
+					for (const auto& tag : file.tags)
+					{
+						write_sized([&] {
+							write_string(tag.identifier);
+							write_list(tag.fields, [&](const auto& field) {
+								write_field(field);
+							});
+							write_list(tag.assignments, [&](const auto& field) {
+								write_field(field);
+							});
+						});
+					}
+				}
+
+				void visit(const basic_constructable<Traits>& constructable)
+				{
+					write(kind::constructable);
+					write_string(constructable.identifier);
+					write_list(constructable.arguments, [&](const auto& argument) {
+						havoc::visit(*this, argument);
+					});
+				}
+
+				void visit(const basic_dictionary<Traits>& dictionary)
+				{
+					write(kind::dictionary);
+					write_list(dictionary, [&](const auto& property) {
+						write_string(property.first);
+						havoc::visit(*this, property.second);
+					});
+				}
+
+				void visit(const basic_array<Traits>& array)
+				{
+					write(kind::array);
+					write_list(array, [&](const auto& value) {
+						havoc::visit(*this, value);
+					});
+				}
+
+				void visit(const basic_packed_array<Traits>& packed)
+				{
+					if (packed.elements.index() == basic_packed_elements<Traits>::npos)
+					{
+						throw std::invalid_argument("packed array without elements");
+					}
+
+					// The alternatives of basic_packed_elements follow packed_type.
+					auto type = static_cast<packed_type>(packed.elements.index() + 1);
+
+					write(kind::packed_array);
+					write_string(packed.identifier);
+					write(type);
+
+					with_packed_type(type, [&]<typename T>(std::type_identity<T>) {
+						const auto& elements = *packed.elements.template get_if<typename Traits::template vector<T>>();
+
+						write_count(elements.size());
+
+						_output.append((alignof(T) - _output.size() % alignof(T)) % alignof(T), '\0');
+						_output.append(reinterpret_cast<const char*>(elements.data()), elements.size() * sizeof(T));
+					});
+				}
+
+				void visit(bool boolean)
+				{
+					write(kind::boolean);
+					write<std::uint8_t>(boolean);
+				}
+
+				void visit(const typename Traits::string_type& string)
+				{
+					write(kind::string);
+					write_string(string);
+				}
+
+				void visit(std::int64_t integer)
+				{
+					write(kind::integer);
+					write(integer);
+				}
+
+				void visit(double real)
+				{
+					write(kind::real);
+					write(real);
+				}
+
+				void visit(const gd::deferred&)
+				{
+					throw std::invalid_argument("deferred values can not be serialized");
+				}
+
+			private:
+				template <typename T>
+				void write(T value)
+				{
+					_output.append(reinterpret_cast<const char*>(&value), sizeof(T));
+				}
+
+				void write_count(size_t count)
+				{
+					if (count > std::numeric_limits<std::uint32_t>::max())
+					{
+						throw std::length_error("too large for the binary format");
+					}
+
+					write(static_cast<std::uint32_t>(count));
+				}
+
+				void write_string(std::string_view string)
+				{
+					write_count(string.size());
+
+					_output.append(string);
+				}
+
+				void write_field(const basic_field<Traits>& field)
+				{
+					write_string(field.name);
+
+					havoc::visit(*this, field.value);
+				}
+
+				void write_sized(auto content)
+				{
+					auto offset = _output.size();
+
+					write(std::uint32_t());
+
+					content();
+
+					auto size = _output.size() - offset - sizeof(std::uint32_t);
+
+					if (size > std::numeric_limits<std::uint32_t>::max())
+					{
+						throw std::length_error("too large for the binary format");
+					}
+
+					auto size32 = static_cast<std::uint32_t>(size);
+
+					std::memcpy(_output.data() + offset, &size32, sizeof(size32));
+				}
+
+				void write_list(const auto& list, auto element)
+				{
+					write_count(list.size());
+					write_sized([&] {
+						for (const auto& item : list)
+						{
+							element(item);
+						}
+					});
+				}
+
+				std::string& _output;
+			};
+
+			class reader
+			{
+			public:
+				explicit reader(std::string_view data, size_t position = 0)
+					: _data(data)
+					, _position(position)
+				{
+				}
+
+				template <typename T>
+				T read()
+				{
+					T value;
+
+					std::memcpy(&value, take(sizeof(T)).data(), sizeof(T));
+
+					return value;
+				}
+
+				std::string_view take(size_t size)
+				{
+					if (size > _data.size() - _position)
+					{
+						throw std::invalid_argument("truncated binary file");
+					}
+
+					auto bytes = _data.substr(_position, size);
+
+					_position += size;
+
+					return bytes;
+				}
+
+				std::string_view read_string()
+				{
+					return take(read<std::uint32_t>());
+				}
+
+				// Reads the count of a list and returns it, after checking that the
+				// list could fit in the rest of the data.
+				std::uint32_t read_count()
+				{
+					auto count = read<std::uint32_t>();
+
+					if (count > _data.size() - _position)
+					{
+						throw std::invalid_argument("truncated binary file");
+					}
+
+					return count;
+				}
+
+				void align(size_t alignment)
+				{
+					take((alignment - _position % alignment) % alignment);
+				}
+
+				void read_header()
+				{
+					if (take(magic.size()) != magic || read<std::uint32_t>() != version)
+					{
+						throw std::invalid_argument("not a binary file of a supported version");
+					}
+				}
+
+				size_t position() const
+				{
+					return _position;
+				}
+
+			private:
+				std::string_view _data;
+
+				size_t _position;
+			};
+
+			template <typename Traits>
+			class decoder
+			{
+			public:
+				using allocator_type = typename Traits::allocator_type;
+				using string_type = typename Traits::string_type;
+				using value_type = basic_value<Traits>;
+				using field_type = basic_field<Traits>;
+				using tag_type = basic_tag<Traits>;
+				using file_type = basic_file<Traits>;
+
+				decoder(std::string_view data, const allocator_type& allocator, size_t position = 0)
+					: _reader(data, position)
+					, _allocator(allocator)
+				{
+				}
+
+				file_type read_file()
+				{
+					_reader.read_header();
+
+					file_type file {
+						.tags = make_vector<tag_type>(),
+					};
+
+					read_list(file.tags, _reader.read_count(), [&] {
+						_reader.read<std::uint32_t>();
+
+						tag_type tag {
+							.identifier = make_string(_reader.read_string()),
+							.fields = make_vector<field_type>(),
+							.assignments = make_vector<field_type>(),
+						};
+
+						read_list(tag.fields, read_list_header(), [&] {
+							return read_field();
+						});
+
+						read_list(tag.assignments, read_list_header(), [&] {
+							return read_field();
+						});
+
+						return tag;
+					});
+
+					return file;
+				}
+
+				value_type read_value()
+				{
+					auto value = make<value_type>();
+
+					switch (_reader.read<kind>())
+					{
+					case kind::constructable:
+					{
+						basic_constructable<Traits> constructable {
+							.identifier = make_string(_reader.read_string()),
+							.arguments = make_vector<value_type>(),
+						};
+
+						read_list(constructable.arguments, read_list_header(), [&] {
+							return read_value();
+						});
+
+						value = std::move(constructable);
+
+						break;
+					}
+					case kind::dictionary:
+					{
+						auto dictionary = make<basic_dictionary<Traits>>();
+
+						read_list(dictionary, read_list_header(), [&] {
+							auto key = make_string(_reader.read_string());
+
+							return std::pair(std::move(key), read_value());
+						});
+
+						value = std::move(dictionary);
+
+						break;
+					}
+					case kind::array:
+					{
+						auto array = make_vector<value_type>();
+
+						read_list(array, read_list_header(), [&] {
+							return read_value();
+						});
+
+						value = std::move(array);
+
+						break;
+					}
+					case kind::packed_array:
+					{
+						basic_packed_array<Traits> packed {
+							.identifier = make_string(_reader.read_string()),
+							.elements = make<basic_packed_elements<Traits>>(),
+						};
+
+						auto type = _reader.read<packed_type>();
+
+						if (type <= packed_type::none || type > packed_type::float64)
+						{
+							throw std::invalid_argument("corrupt binary file");
+						}
+
+						with_packed_type(type, [&]<typename T>(std::type_identity<T>) {
+							auto elements = make_vector<T>();
+							auto count = _reader.read<std::uint32_t>();
+
+							_reader.align(alignof(T));
+
+							auto bytes = _reader.take(size_t(count) * sizeof(T));
+
+							elements.resize(count);
+
+							if (count)
+							{
+								std::memcpy(elements.data(), bytes.data(), bytes.size());
+							}
+
+							packed.elements = std::move(elements);
+						});
+
+						value = std::move(packed);
+
+						break;
+					}
+					case kind::boolean:
+						value = _reader.read<std::uint8_t>() != 0;
+						break;
+					case kind::string:
+						value = make_string(_reader.read_string());
+						break;
+					case kind::integer:
+						value = _reader.read<std::int64_t>();
+						break;
+					case kind::real:
+						value = _reader.read<double>();
+						break;
+					default:
+						throw std::invalid_argument("corrupt binary file");
+					}
+
+					return value;
+				}
+
+			private:
+				template <typename T>
+				T make() const
+				{
+					return std::make_obj_using_allocator<T>(_allocator);
+				}
+
+				string_type make_string(std::string_view string) const
+				{
+					return std::make_obj_using_allocator<string_type>(_allocator, string);
+				}
+
+				template <typename T>
+				typename Traits::template vector<T> make_vector() const
+				{
+					return make<typename Traits::template vector<T>>();
+				}
+
+				std::uint32_t read_list_header()
+				{
+					auto count = _reader.read_count();
+
+					_reader.read<std::uint32_t>();
+
+					return count;
+				}
+
+				void read_list(auto& list, std::uint32_t count, auto element)
+				{
+					if constexpr (requires { list.push_back(element()); })
+					{
+						list.reserve(count);
+
+						for (std::uint32_t i = 0; i < count; i++)
+						{
+							list.push_back(element());
+						}
+					}
+					else
+					{
+						for (std::uint32_t i = 0; i < count; i++)
+						{
+							list.insert(element());
+						}
+					}
+				}
+
+				field_type read_field()
+				{
+					auto name = make_string(_reader.read_string());
+
+					return field_type {
+						.name = std::move(name),
+						.value = read_value(),
+					};
+				}
+
+				reader _reader;
+
+				allocator_type _allocator;
+			};
+		}
+
+		// A fast 128 bit hash for cache keys. It is not meant to withstand
+		// deliberately colliding inputs.
+		inline std::pair<std::uint64_t, std::uint64_t> content_hash(std::string_view data)
+		{
+			constexpr std::uint64_t k0 = 0x9e3779b97f4a7c15;
+			constexpr std::uint64_t k1 = 0xc2b2ae3d27d4eb4f;
+
+			auto finalize = [](std::uint64_t hash) {
+				hash ^= hash >> 33;
+				hash *= 0xff51afd7ed558ccd;
+				hash ^= hash >> 33;
+				hash *= 0xc4ceb9fe1a85ec53;
+				hash ^= hash >> 33;
+
+				return hash;
+			};
+
+			std::uint64_t low = data.size() * k0;
+			std::uint64_t high = data.size() * k1 + 1;
+
+			auto mix = [&](std::uint64_t word) {
+				low = std::rotl((low ^ word) * k0, 31);
+				high = std::rotl((high + word) * k1, 29) ^ low;
+			};
+
+			size_t i = 0;
+
+			for (; i + sizeof(std::uint64_t) <= data.size(); i += sizeof(std::uint64_t))
+			{
+				std::uint64_t word;
+
+				std::memcpy(&word, data.data() + i, sizeof(word));
+
+				mix(word);
+			}
+
+			if (i < data.size())
+			{
+				std::uint64_t word = 0;
+
+				std::memcpy(&word, data.data() + i, data.size() - i);
+
+				mix(word);
+			}
+
+			return { finalize(low ^ high), finalize(high + low * k1) };
+		}
+	}
+
+	// Writes a file in the binary format read by gd::deserialize.
+	template <typename Traits>
+	std::string serialize(const basic_file<Traits>& file)
+	{
+		static_assert(!std::is_same_v<typename Traits::identifier_type, gd::symbol>, "Interned files can not be serialized");
+
+		std::string output;
+
+		detail::binary::writer<Traits>(output).write_file(file);
+
+		return output;
+	}
+
+	// Reads a file written by gd::serialize. With view traits the strings of
+	// the result point into data. Throws std::invalid_argument if data is not
+	// a valid binary file of the current version.
+	template <typename Traits = default_traits>
+	basic_file<Traits> deserialize(std::string_view data, const typename Traits::allocator_type& allocator = {})
+	{
+		static_assert(!std::is_same_v<typename Traits::identifier_type, gd::symbol>, "Interned files can not be deserialized");
+
+		return detail::binary::decoder<Traits>(data, allocator).read_file();
+	}
+
+	namespace binary
+	{
+		template <typename Element>
+		class list_view
+		{
+		public:
+			class iterator
+			{
+			public:
+				using value_type = Element;
+				using difference_type = std::ptrdiff_t;
+
+				iterator() = default;
+
+				iterator(std::string_view data, size_t position, std::uint32_t remaining)
+					: _data(data)
+					, _position(position)
+					, _remaining(remaining)
+				{
+				}
+
+				Element operator*() const
+				{
+					return Element(_data, _position);
+				}
+
+				iterator& operator++()
+				{
+					_position = Element::skip(_data, _position);
+					_remaining--;
+
+					return *this;
+				}
+
+				iterator operator++(int)
+				{
+					auto previous = *this;
+
+					++*this;
+
+					return previous;
+				}
+
+				bool operator==(std::default_sentinel_t) const
+				{
+					return _remaining == 0;
+				}
+
+			private:
+				std::string_view _data;
+
+				size_t _position = 0;
+
+				std::uint32_t _remaining = 0;
+			};
+
+			list_view(std::string_view data, size_t position, std::uint32_t count)
+				: _data(data)
+				, _position(position)
+				, _count(count)
+			{
+			}
+
+			iterator begin() const
+			{
+				return { _data, _position, _count };
+			}
+
+			std::default_sentinel_t end() const
+			{
+				return {};
+			}
+
+			size_t size() const
+			{
+				return _count;
+			}
+
+			bool empty() const
+			{
+				return _count == 0;
+			}
+
+		private:
+			std::string_view _data;
+
+			size_t _position;
+
+			std::uint32_t _count;
 		};
 
-		parser["String"] = [](peg::SemanticValues values) {
-			return values.token_to_string();
+		class field_view;
+
+		// A value inside binary data written by gd::serialize. Accessors for a
+		// different kind of value throw std::invalid_argument.
+		class value_view
+		{
+		public:
+			value_view(std::string_view data, size_t position)
+				: _data(data)
+				, _position(position)
+			{
+			}
+
+			binary::kind kind() const
+			{
+				return reader().read<binary::kind>();
+			}
+
+			bool boolean() const
+			{
+				return payload(binary::kind::boolean).read<std::uint8_t>() != 0;
+			}
+
+			std::int64_t integer() const
+			{
+				return payload(binary::kind::integer).read<std::int64_t>();
+			}
+
+			double real() const
+			{
+				return payload(binary::kind::real).read<double>();
+			}
+
+			std::string_view string() const
+			{
+				return payload(binary::kind::string).read_string();
+			}
+
+			// The identifier of a constructable or packed array.
+			std::string_view identifier() const
+			{
+				auto reader = this->reader();
+				auto type = reader.read<binary::kind>();
+
+				if (type != binary::kind::constructable && type != binary::kind::packed_array)
+				{
+					throw std::invalid_argument("value has no identifier");
+				}
+
+				return reader.read_string();
+			}
+
+			list_view<value_view> arguments() const
+			{
+				auto reader = payload(binary::kind::constructable);
+
+				reader.read_string();
+
+				return list(reader);
+			}
+
+			list_view<value_view> elements() const
+			{
+				auto reader = payload(binary::kind::array);
+
+				return list(reader);
+			}
+
+			list_view<field_view> properties() const;
+
+			// The elements of a packed array, straight from the data. T has to be
+			// the element type of the array, e.g. float for a PackedVector3Array.
+			template <typename T>
+			std::span<const T> packed() const
+			{
+				auto reader = payload(binary::kind::packed_array);
+
+				reader.read_string();
+
+				auto type = reader.read<detail::packed_type>();
+
+				if (type <= detail::packed_type::none || type > detail::packed_type::float64 || !detail::with_packed_type(type, []<typename U>(std::type_identity<U>) { return std::is_same_v<T, U>; }))
+				{
+					throw std::invalid_argument("packed array has a different element type");
+				}
+
+				auto count = reader.read<std::uint32_t>();
+
+				reader.align(alignof(T));
+
+				return { reinterpret_cast<const T*>(reader.take(size_t(count) * sizeof(T)).data()), count };
+			}
+
+			template <typename Traits = default_traits>
+			basic_value<Traits> decode(const typename Traits::allocator_type& allocator = {}) const
+			{
+				return detail::binary::decoder<Traits>(_data, allocator, _position).read_value();
+			}
+
+			static size_t skip(std::string_view data, size_t position)
+			{
+				detail::binary::reader reader(data, position);
+
+				switch (reader.read<binary::kind>())
+				{
+				case binary::kind::constructable:
+					reader.read_string();
+					skip_list(reader);
+					break;
+				case binary::kind::dictionary:
+				case binary::kind::array:
+					skip_list(reader);
+					break;
+				case binary::kind::packed_array:
+				{
+					reader.read_string();
+
+					auto type = reader.read<detail::packed_type>();
+					auto count = reader.read<std::uint32_t>();
+
+					if (type <= detail::packed_type::none || type > detail::packed_type::float64)
+					{
+						throw std::invalid_argument("corrupt binary file");
+					}
+
+					detail::with_packed_type(type, [&]<typename T>(std::type_identity<T>) {
+						reader.align(alignof(T));
+						reader.take(size_t(count) * sizeof(T));
+					});
+
+					break;
+				}
+				case binary::kind::boolean:
+					reader.read<std::uint8_t>();
+					break;
+				case binary::kind::string:
+					reader.read_string();
+					break;
+				case binary::kind::integer:
+				case binary::kind::real:
+					reader.read<std::uint64_t>();
+					break;
+				default:
+					throw std::invalid_argument("corrupt binary file");
+				}
+
+				return reader.position();
+			}
+
+		private:
+			detail::binary::reader reader() const
+			{
+				return detail::binary::reader(_data, _position);
+			}
+
+			detail::binary::reader payload(binary::kind expected) const
+			{
+				auto reader = this->reader();
+
+				if (reader.read<binary::kind>() != expected)
+				{
+					throw std::invalid_argument("value is of a different kind");
+				}
+
+				return reader;
+			}
+
+			list_view<value_view> list(detail::binary::reader& reader) const
+			{
+				auto count = reader.read<std::uint32_t>();
+
+				reader.read<std::uint32_t>();
+
+				return { _data, reader.position(), count };
+			}
+
+			static void skip_list(detail::binary::reader& reader)
+			{
+				reader.read<std::uint32_t>();
+				reader.take(reader.read<std::uint32_t>());
+			}
+
+			std::string_view _data;
+
+			size_t _position;
 		};
 
-		parser["Identifier"] = [](peg::SemanticValues values) {
-			return values.token_to_string();
+		// A field of a tag, or a property of a dictionary with its key as name.
+		class field_view
+		{
+		public:
+			field_view(std::string_view data, size_t position)
+				: _data(data)
+				, _position(position)
+			{
+			}
+
+			std::string_view name() const
+			{
+				return detail::binary::reader(_data, _position).read_string();
+			}
+
+			value_view value() const
+			{
+				detail::binary::reader reader(_data, _position);
+
+				reader.read_string();
+
+				return { _data, reader.position() };
+			}
+
+			static size_t skip(std::string_view data, size_t position)
+			{
+				detail::binary::reader reader(data, position);
+
+				reader.read_string();
+
+				return value_view::skip(data, reader.position());
+			}
+
+		private:
+			std::string_view _data;
+
+			size_t _position;
 		};
 
-		parser["Boolean"] = [](peg::SemanticValues values) {
-			return values.token_to_string() == "true";
+		inline list_view<field_view> value_view::properties() const
+		{
+			auto reader = payload(binary::kind::dictionary);
+			auto count = reader.read<std::uint32_t>();
+
+			reader.read<std::uint32_t>();
+
+			return { _data, reader.position(), count };
+		}
+
+		class tag_view
+		{
+		public:
+			tag_view(std::string_view data, size_t position)
+				: _data(data)
+				, _position(position)
+			{
+			}
+
+			std::string_view identifier() const
+			{
+				auto reader = this->reader();
+
+				return reader.read_string();
+			}
+
+			list_view<field_view> fields() const
+			{
+				auto reader = this->reader();
+
+				reader.read_string();
+
+				return list(reader);
+			}
+
+			list_view<field_view> assignments() const
+			{
+				auto reader = this->reader();
+
+				reader.read_string();
+				reader.read<std::uint32_t>();
+				reader.take(reader.read<std::uint32_t>());
+
+				return list(reader);
+			}
+
+			static size_t skip(std::string_view data, size_t position)
+			{
+				detail::binary::reader reader(data, position);
+
+				reader.take(reader.read<std::uint32_t>());
+
+				return reader.position();
+			}
+
+		private:
+			detail::binary::reader reader() const
+			{
+				detail::binary::reader reader(_data, _position);
+
+				reader.read<std::uint32_t>();
+
+				return reader;
+			}
+
+			list_view<field_view> list(detail::binary::reader& reader) const
+			{
+				auto count = reader.read<std::uint32_t>();
+
+				reader.read<std::uint32_t>();
+
+				return { _data, reader.position(), count };
+			}
+
+			std::string_view _data;
+
+			size_t _position;
 		};
 
-		parser["Numeric"] = [](peg::SemanticValues values) {
-			return values.token_to_number<float>();
+		// Walks binary data written by gd::serialize in place, typically from a
+		// gd::mapped_file, without building a gd::file. The data has to stay
+		// alive and be aligned to 8 bytes, which mapped files and heap buffers
+		// always are. Anything that would read outside of it throws
+		// std::invalid_argument.
+		class file_view
+		{
+		public:
+			explicit file_view(std::string_view data)
+				: _data(data)
+			{
+				if (reinterpret_cast<std::uintptr_t>(data.data()) % alignof(std::uint64_t))
+				{
+					throw std::invalid_argument("binary data is not aligned");
+				}
+
+				detail::binary::reader reader(data);
+
+				reader.read_header();
+
+				_count = reader.read_count();
+				_position = reader.position();
+			}
+
+			list_view<tag_view> tags() const
+			{
+				return { _data, _position, _count };
+			}
+
+		private:
+			std::string_view _data;
+
+			size_t _position;
+
+			std::uint32_t _count;
 		};
+	}
+
+	// Caches parse results on disk in the binary format, keyed by a hash of the
+	// input. Entries live in a subdirectory named after the format version and
+	// the grammar, so that they are never reused by a parser that would produce
+	// a different result. Failed parses are not cached, so that their errors
+	// are reported every time. Any number of threads and processes can share
+	// a cache directory.
+	class parse_cache
+	{
+	public:
+		explicit parse_cache(const std::filesystem::path& directory)
+		{
+			auto [grammar, _] = detail::content_hash(detail::grammar);
+
+			_directory = directory / ("v" + std::to_string(detail::binary::version) + "-" + hex(grammar));
 
-		parser["Value"] = [](peg::SemanticValues values) -> gd::value {
-			switch (values.choice())
+			std::filesystem::create_directories(_directory);
+		}
+
+		gd::file parse(std::string_view input, gd::backend backend = gd::backend::peg) const
+		{
+			auto [low, high] = detail::content_hash(input);
+			auto path = _directory / (hex(low) + hex(high));
+
+			if (auto file = load(path))
+			{
+				return std::move(*file);
+			}
+
+			auto file = gd::parse(input, backend);
+
+			if (!file.tags.empty())
+			{
+				store(path, file);
+			}
+
+			return file;
+		}
+
+		gd::file parse_file(const std::filesystem::path& path, gd::backend backend = gd::backend::peg) const
+		{
+			gd::mapped_file mapping(path);
+
+			return parse(mapping.view(), backend);
+		}
+
+		const std::filesystem::path& directory() const
+		{
+			return _directory;
+		}
+
+	private:
+		static std::string hex(std::uint64_t value)
+		{
+			std::string digits(16, '0');
+
+			for (auto i = digits.size(); i-- > 0; value >>= 4)
+			{
+				digits[i] = "0123456789abcdef"[value & 15];
+			}
+
+			return digits;
+		}
+
+		// A missing, truncated or otherwise unreadable entry is a miss.
+		static std::optional<gd::file> load(const std::filesystem::path& path)
+		{
+			std::error_code error;
+
+			if (!std::filesystem::is_regular_file(path, error))
 			{
-			case 0:
-				return std::any_cast<float>(values[0]);
-			case 1:
-				return std::any_cast<std::string>(values[0]);
-			case 2:
-				return std::any_cast<gd::constructable>(values[0]);
-			case 3:
-				return std::any_cast<gd::dictionary_t>(values[0]);
-			case 4:
-				return std::any_cast<gd::array_t>(values[0]);
-			case 5:
-				return std::any_cast<bool>(values[0]);
-			default:
 				return {};
 			}
-		};
 
-		parser.set_logger([](auto file, auto column, auto message) {
-			std::cerr << file << ":" << column << ": " << message << std::endl;
+			try
+			{
+				gd::mapped_file mapping(path);
+
+				return gd::deserialize(mapping.view());
+			}
+			catch (const std::exception&)
+			{
+				return {};
+			}
+		}
+
+		// Entries are written to a temporary file first and then renamed, so
+		// that concurrent readers never see a partial entry. The temporary name
+		// includes the process and thread, since several processes may share
+		// the cache. Failing to write one is not an error.
+		static void store(const std::filesystem::path& path, const gd::file& file)
+		{
+#if defined(_WIN32)
+			auto process = static_cast<std::uint64_t>(GetCurrentProcessId());
+#else
+			auto process = static_cast<std::uint64_t>(getpid());
+#endif
+
+			auto temporary = path;
+
+			temporary += ".tmp" + std::to_string(process) + "-" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+
+			{
+				std::ofstream stream(temporary, std::ios::binary);
+
+				auto data = gd::serialize(file);
+
+				if (!stream.write(data.data(), data.size()))
+				{
+					return;
+				}
+			}
+
+			std::error_code error;
+
+			std::filesystem::rename(temporary, path, error);
+
+			if (error)
+			{
+				std::filesystem::remove(temporary, error);
+			}
+		}
+
+		std::filesystem::path _directory;
+	};
+
+	inline std::vector<gd::file> parse_many(std::span<const std::filesystem::path> paths, const gd::parse_cache& cache, gd::backend backend = gd::backend::peg, size_t threads = 0)
+	{
+		std::vector<gd::file> files(paths.size());
+
+		detail::parallel_for(paths.size(), threads, [&](size_t index, size_t) {
+			files[index] = cache.parse_file(paths[index], backend);
 		});
 
-		std::stringstream stringstream;
-		stringstream << stream.rdbuf();
+		return files;
+	}
+
+	inline std::vector<std::pair<std::filesystem::path, gd::file>> parse_project(const std::filesystem::path& root, const gd::parse_cache& cache, gd::backend backend = gd::backend::peg, size_t threads = 0)
+	{
+		auto paths = find_resource_files(root);
+		auto files = parse_many(paths, cache, backend, threads);
 
-		gd::file file;
+		std::vector<std::pair<std::filesystem::path, gd::file>> project;
 
-		auto str = stringstream.str();
+		for (size_t i = 0; i < paths.size(); i++)
+		{
+			project.emplace_back(std::move(paths[i]), std::move(files[i]));
+		}
 
-		parser.parse({ begin(str), std::min(end(str), std::ranges::find(str, '\0')) }, file);
+		return project;
+	}
 
-		return file;
+	namespace interned
+	{
+		inline gd::interned::file parse(std::string_view input, gd::symbol_table& symbols)
+		{
+			return gd::parse<traits>(input, symbols);
+		}
+	}
+
+	namespace view
+	{
+		inline gd::view::file parse(std::string_view input)
+		{
+			return gd::parse<traits>(input);
+		}
+	}
+
+	namespace pmr
+	{
+		class document
+		{
+		public:
+			explicit document(size_t initial_size = 0)
+				: _resource(std::make_unique<std::pmr::monotonic_buffer_resource>(std::max<size_t>(initial_size, 1024)))
+			{
+				std::pmr::polymorphic_allocator<> allocator(_resource.get());
+
+				_file = allocator.new_object<gd::pmr::file>(gd::pmr::file {
+					.tags = gd::pmr::traits::vector<gd::pmr::tag>(allocator),
+				});
+			}
+
+			document(document&& other) noexcept
+				: _resource(std::move(other._resource))
+				, _file(std::exchange(other._file, nullptr))
+			{
+			}
+
+			document(const document&) = delete;
+
+			~document()
+			{
+				destroy();
+			}
+
+			document& operator=(document&& other) noexcept
+			{
+				if (this != &other)
+				{
+					destroy();
+
+					_resource = std::move(other._resource);
+					_file = std::exchange(other._file, nullptr);
+				}
+
+				return *this;
+			}
+
+			document& operator=(const document&) = delete;
+
+			gd::pmr::file& file() const
+			{
+				return *_file;
+			}
+
+			gd::pmr::file& operator*() const
+			{
+				return *_file;
+			}
+
+			gd::pmr::file* operator->() const
+			{
+				return _file;
+			}
+
+			std::pmr::memory_resource* resource() const
+			{
+				return _resource.get();
+			}
+
+		private:
+			// Runs the destructors of the tree before the arena is released, so
+			// anything it holds outside the arena is freed as well.
+			void destroy()
+			{
+				if (_file)
+				{
+					std::pmr::polymorphic_allocator<>(_resource.get()).delete_object(_file);
+
+					_file = nullptr;
+				}
+			}
+
+			std::unique_ptr<std::pmr::monotonic_buffer_resource> _resource;
+
+			// Lives inside the arena. Null once the document has been moved from.
+			gd::pmr::file* _file = nullptr;
+		};
+
+		inline gd::pmr::file parse(std::string_view input, std::pmr::memory_resource* resource)
+		{
+			return gd::parse<traits>(input, resource);
+		}
+
+		inline gd::pmr::document parse(std::string_view input)
+		{
+			gd::pmr::document document(input.size());
+
+			document.file() = parse(input, document.resource());
+
+			return document;
+		}
+
+		inline gd::pmr::document parse_file(const std::filesystem::path& path)
+		{
+			gd::mapped_file mapping(path);
+
+			return parse(mapping.view());
+		}
+
+		class batch
+		{
+		public:
+			batch() = default;
+
+			batch(size_t size, size_t arenas)
+				: _files(size)
+			{
+				for (size_t i = 0; i < arenas; i++)
+				{
+					_arenas.push_back(std::make_unique<std::pmr::monotonic_buffer_resource>());
+				}
+			}
+
+			size_t size() const
+			{
+				return _files.size();
+			}
+
+			gd::pmr::file& operator[](size_t index) const
+			{
+				return *_files[index];
+			}
+
+			std::pmr::memory_resource* arena(size_t index) const
+			{
+				return _arenas[index].get();
+			}
+
+			void emplace(size_t index, size_t arena, gd::pmr::file&& file)
+			{
+				std::pmr::polymorphic_allocator<> allocator(_arenas[arena].get());
+
+				_files[index] = allocator.new_object<gd::pmr::file>(std::move(file));
+			}
+
+		private:
+			std::vector<std::unique_ptr<std::pmr::monotonic_buffer_resource>> _arenas;
+
+			// Like document, the files live inside the arenas and are never
+			// destroyed.
+			std::vector<gd::pmr::file*> _files;
+		};
+
+		inline gd::pmr::batch parse_many(std::span<const std::filesystem::path> paths, size_t threads = 0)
+		{
+			threads = detail::thread_count(threads);
+
+			gd::pmr::batch batch(paths.size(), threads);
+
+			detail::parallel_for(paths.size(), threads, [&](size_t index, size_t worker) {
+				gd::mapped_file mapping(paths[index]);
+
+				batch.emplace(index, worker, parse(mapping.view(), batch.arena(worker)));
+			});
+
+			return batch;
+		}
 	}
 }
+
+template <>
+struct std::hash<gd::symbol>
+{
+	size_t operator()(gd::symbol symbol) const noexcept
+	{
+		return std::hash<std::uint32_t>()(symbol.id);
+	}
+};
@@ -1,13 +1,18 @@
 #pragma once
 
-#include <atomic>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
 #include <memory>
+#include <new>
 #include <optional>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 
 namespace havoc
 {
-	static inline std::atomic_uint64_t _counter;
-
 	template <typename T>
 	struct optional
 	{
@@ -89,139 +94,396 @@ namespace havoc
 		std::unique_ptr<T> _storage;
 	};
 
-	template <typename T, typename... Ts>
-	struct option
-		: option<T>
-		, option<Ts...>
+	template <typename T>
+	struct is_inline : std::is_scalar<T>
+	{
+	};
+
+	template <typename C, typename Traits>
+	struct is_inline<std::basic_string_view<C, Traits>> : std::true_type
 	{
-		using option<T>::option;
-		using option<Ts...>::option;
+	};
+
+	template <typename T>
+	static constexpr auto is_inline_v = is_inline<T>::value;
 
-		using option<T>::operator=;
-		using option<Ts...>::operator=;
+	template <typename T, bool = is_inline_v<T>>
+	struct inline_traits
+	{
+		static constexpr size_t size = 0;
+		static constexpr size_t alignment = 1;
 	};
 
 	template <typename T>
-	struct option<T>
+	struct inline_traits<T, true>
 	{
-		option()
-			: _timestamp(0)
+		static constexpr size_t size = sizeof(T);
+		static constexpr size_t alignment = alignof(T);
+	};
+
+	template <typename Allocator, typename... T>
+	struct basic_one_of
+	{
+		using types = std::tuple<T...>;
+		using allocator_type = Allocator;
+
+		static constexpr auto npos = static_cast<size_t>(-1);
+
+		template <typename U>
+		static constexpr size_t index_of()
+		{
+			constexpr bool matches[] = { std::is_same_v<U, T>... };
+
+			for (size_t i = 0; i < sizeof...(T); i++)
+			{
+				if (matches[i])
+				{
+					return i;
+				}
+			}
+
+			return npos;
+		}
+
+		basic_one_of() = default;
+
+		basic_one_of(std::allocator_arg_t, const Allocator& allocator)
+			: _allocator(allocator)
 		{
 		}
 
-		option(T&& value)
-			: _storage(value)
-			, _timestamp(++_counter)
+		template <typename U, size_t I = index_of<std::remove_cvref_t<U>>()>
+			requires(I != npos)
+		basic_one_of(U&& value)
 		{
+			emplace<I>(std::forward<U>(value));
 		}
 
-		option(const T& value)
-			: _storage(value)
-			, _timestamp(++_counter)
+		template <typename U, size_t I = index_of<std::remove_cvref_t<U>>()>
+			requires(I != npos)
+		basic_one_of(std::allocator_arg_t, const Allocator& allocator, U&& value)
+			: _allocator(allocator)
 		{
+			emplace<I>(std::forward<U>(value));
 		}
 
-		option(option<T>&& other)
-			: _storage(std::move(other._storage))
-			, _timestamp(other._timestamp)
+		basic_one_of(basic_one_of&& other) noexcept
+			: _allocator(other._allocator)
 		{
+			steal(other);
 		}
 
-		option(const option<T>& other)
-			: _storage(other._storage)
-			, _timestamp(other._timestamp)
+		basic_one_of(std::allocator_arg_t, const Allocator& allocator, basic_one_of&& other)
+			: _allocator(allocator)
 		{
+			assign(std::move(other));
 		}
 
-		option& operator=(T&& value)
+		basic_one_of(const basic_one_of& other)
+			: _allocator(std::allocator_traits<Allocator>::select_on_container_copy_construction(other._allocator))
 		{
-			_timestamp = ++_counter;
-			_storage = value;
+			assign(other);
+		}
+
+		basic_one_of(std::allocator_arg_t, const Allocator& allocator, const basic_one_of& other)
+			: _allocator(allocator)
+		{
+			assign(other);
+		}
+
+		~basic_one_of()
+		{
+			reset();
+		}
+
+		template <typename U, size_t I = index_of<std::remove_cvref_t<U>>()>
+			requires(I != npos)
+		basic_one_of& operator=(U&& value)
+		{
+			*this = basic_one_of(std::allocator_arg, _allocator, std::forward<U>(value));
 
 			return *this;
 		}
 
-		option& operator=(const option<T>& other)
+		basic_one_of& operator=(basic_one_of&& other) noexcept(std::allocator_traits<Allocator>::is_always_equal::value)
 		{
-			_timestamp = other._timestamp;
-			_storage = other._storage;
+			if (this != &other)
+			{
+				// The source may live inside the current value, for example an
+				// element of an array being assigned to the value holding the
+				// array, so take it out before the current value is destroyed.
+				basic_one_of taken(std::allocator_arg, _allocator, std::move(other));
+
+				reset();
+				steal(taken);
+			}
 
 			return *this;
 		}
 
-		T& operator*() const
+		basic_one_of& operator=(const basic_one_of& other)
 		{
-			return _storage.get_or_create();
+			if (this != &other)
+			{
+				*this = basic_one_of(std::allocator_arg, _allocator, other);
+			}
+
+			return *this;
 		}
 
-		size_t timestamp() const
+		size_t index() const
 		{
-			return _timestamp;
+			return _index;
 		}
 
-	private:
-		mutable optional<T> _storage;
+		Allocator get_allocator() const
+		{
+			return _allocator;
+		}
 
-		size_t _timestamp;
-	};
+		template <typename U>
+		U* get_if()
+		{
+			if constexpr (constexpr auto I = index_of<U>(); I != npos)
+			{
+				if (_index == I)
+				{
+					return get<I>();
+				}
+			}
 
-	template <typename... T>
-	struct one_of : option<T...>
-	{
-		using option<T...>::option;
-		using option<T...>::operator=;
+			return nullptr;
+		}
 
-		using types = std::tuple<T...>;
-	};
+		template <typename U>
+		const U* get_if() const
+		{
+			return const_cast<basic_one_of*>(this)->template get_if<U>();
+		}
 
-	template <typename T, typename... Ts>
-	struct visitor_helper
-	{
-		static auto visit(size_t timestamp, auto visitor, const auto& input)
-			-> std::optional<typename decltype(visitor)::result>
+		template <size_t I>
+		auto get() -> std::tuple_element_t<I, types>*
 		{
-			if (auto& value = static_cast<const option<T>&>(input); value.timestamp() > timestamp)
+			using U = std::tuple_element_t<I, types>;
+
+			if constexpr (is_inline_v<U>)
 			{
-				if (auto result = visitor_helper<Ts...>::visit(value.timestamp(), visitor, input))
+				return std::launder(reinterpret_cast<U*>(_buffer));
+			}
+			else
+			{
+				return *reinterpret_cast<U**>(_buffer);
+			}
+		}
+
+		template <size_t I>
+		auto get() const -> const std::tuple_element_t<I, types>*
+		{
+			return const_cast<basic_one_of*>(this)->template get<I>();
+		}
+
+		void reset()
+		{
+			dispatch([&]<size_t I>(std::integral_constant<size_t, I>) {
+				using U = std::tuple_element_t<I, types>;
+
+				if constexpr (!is_inline_v<U>)
 				{
-					return *result;
+					using allocator_t = typename std::allocator_traits<Allocator>::template rebind_alloc<U>;
+					using traits_t = std::allocator_traits<allocator_t>;
+
+					allocator_t allocator(_allocator);
+
+					traits_t::destroy(allocator, get<I>());
+					traits_t::deallocate(allocator, get<I>(), 1);
 				}
-				else
+			});
+
+			_index = npos;
+		}
+
+	private:
+		template <size_t I, typename... Args>
+		void emplace(Args&&... args)
+		{
+			using U = std::tuple_element_t<I, types>;
+
+			reset();
+
+			if constexpr (is_inline_v<U>)
+			{
+				new (_buffer) U(std::forward<Args>(args)...);
+			}
+			else
+			{
+				using allocator_t = typename std::allocator_traits<Allocator>::template rebind_alloc<U>;
+				using traits_t = std::allocator_traits<allocator_t>;
+
+				allocator_t allocator(_allocator);
+
+				auto pointer = traits_t::allocate(allocator, 1);
+
+				try
 				{
-					return visitor.visit(*value);
+					traits_t::construct(allocator, pointer, std::forward<Args>(args)...);
 				}
+				catch (...)
+				{
+					traits_t::deallocate(allocator, pointer, 1);
+
+					throw;
+				}
+
+				*reinterpret_cast<U**>(_buffer) = pointer;
+			}
+
+			_index = I;
+		}
+
+		void steal(basic_one_of& other)
+		{
+			std::memcpy(_buffer, other._buffer, sizeof(_buffer));
+
+			_index = std::exchange(other._index, npos);
+		}
+
+		void assign(basic_one_of&& other)
+		{
+			if (_allocator == other._allocator)
+			{
+				steal(other);
 			}
 			else
 			{
-				return visitor_helper<Ts...>::visit(timestamp, visitor, input);
+				other.dispatch([&]<size_t I>(std::integral_constant<size_t, I>) {
+					emplace<I>(std::move(*other.template get<I>()));
+				});
+
+				other.reset();
 			}
 		}
+
+		void assign(const basic_one_of& other)
+		{
+			other.dispatch([&]<size_t I>(std::integral_constant<size_t, I>) {
+				emplace<I>(*other.template get<I>());
+			});
+		}
+
+		void dispatch(auto function) const
+		{
+			[&]<size_t... I>(std::index_sequence<I...>) {
+				((_index == I && (function(std::integral_constant<size_t, I>()), true)) || ...);
+			}(std::index_sequence_for<T...>());
+		}
+
+		alignas(std::max({ alignof(void*), inline_traits<T>::alignment... })) std::byte _buffer[std::max({ sizeof(void*), inline_traits<T>::size... })];
+
+		size_t _index = npos;
+
+		[[no_unique_address]] Allocator _allocator;
 	};
 
+	template <typename... T>
+	using one_of = basic_one_of<std::allocator<std::byte>, T...>;
+
+	template <typename Allocator, typename... T>
+	void as_one_of(const basic_one_of<Allocator, T...>&);
+
 	template <typename T>
-	struct visitor_helper<T>
+	concept variant = requires(const T& input) { as_one_of(input); };
+
+	template <typename Visitor, typename Bound, typename... Rest>
+	struct visitor_continuation;
+
+	struct visitor_helper
 	{
-		static auto visit(size_t timestamp, auto visitor, const auto& input)
-			-> std::optional<typename decltype(visitor)::result>
+		template <typename Visitor>
+		static auto none() -> typename Visitor::result
 		{
-			if (auto& value = static_cast<const option<T>&>(input); value.timestamp() > timestamp)
+			if constexpr (!std::is_void_v<typename Visitor::result>)
 			{
-				return visitor.visit(*value);
+				return {};
 			}
+		}
+
+		template <typename Visitor, typename Input, size_t... I>
+		static auto jump(Visitor& visitor, Input& input, std::index_sequence<I...>) -> typename Visitor::result
+		{
+			using result = typename Visitor::result;
+
+			static constexpr result (*table[])(Visitor&, Input&) = {
+				[](Visitor& visitor, Input& input) -> result {
+					return visitor.visit(*input.template get<I>());
+				}...
+			};
 
-			return {};
+			if (input.index() < sizeof...(I))
+			{
+				return table[input.index()](visitor, input);
+			}
+
+			return none<Visitor>();
+		}
+
+		template <typename Visitor, typename Allocator, typename... T>
+		static auto visit(Visitor& visitor, const basic_one_of<Allocator, T...>& input) -> typename Visitor::result
+		{
+			return jump(visitor, input, std::index_sequence_for<T...>());
+		}
+
+		template <typename Visitor, typename Allocator, typename... T>
+		static auto visit(Visitor& visitor, basic_one_of<Allocator, T...>& input) -> typename Visitor::result
+		{
+			return jump(visitor, input, std::index_sequence_for<T...>());
+		}
+
+		template <typename Visitor, typename... Bound>
+		static auto visit_bound(Visitor& visitor, std::tuple<Bound&...> bound) -> typename Visitor::result
+		{
+			return std::apply([&](auto&... values) -> typename Visitor::result {
+				return visitor.visit(values...);
+			}, bound);
+		}
+
+		template <typename Visitor, typename... Bound, typename Input, typename... Rest>
+		static auto visit_bound(Visitor& visitor, std::tuple<Bound&...> bound, Input& input, Rest&... rest) -> typename Visitor::result
+		{
+			if constexpr (sizeof...(Bound) == 0 && sizeof...(Rest) == 0)
+			{
+				return visit(visitor, input);
+			}
+			else
+			{
+				visitor_continuation<Visitor, std::tuple<Bound&...>, Rest...> continuation { visitor, bound, std::tie(rest...) };
+
+				return visit(continuation, input);
+			}
 		}
 	};
 
-	template <typename... T>
-	auto visit(auto visitor, const one_of<T...>& input) -> decltype(visitor)::result
+	template <typename Visitor, typename Bound, typename... Rest>
+	struct visitor_continuation
 	{
-		if (auto result = visitor_helper<T...>::visit(0, visitor, input))
+		using result = typename Visitor::result;
+
+		Visitor& visitor;
+		Bound bound;
+		std::tuple<Rest&...> rest;
+
+		result visit(auto& value)
 		{
-			return *result;
+			return std::apply([&](auto&... rest) -> result {
+				return visitor_helper::visit_bound(visitor, std::tuple_cat(bound, std::tie(value)), rest...);
+			}, rest);
 		}
+	};
 
-		return {};
+	template <typename... V>
+		requires(sizeof...(V) > 0 && (variant<std::remove_cvref_t<V>> && ...))
+	auto visit(auto visitor, V&&... inputs) -> decltype(visitor)::result
+	{
+		return visitor_helper::visit_bound(visitor, std::tuple<>(), inputs...);
 	}
 
 	template <typename T>
@@ -17,6 +17,7 @@
 
 #include <algorithm>
 #include <any>
+#include <bitset>
 #include <cassert>
 #include <cctype>
 #if __has_include(<charconv>)
@@ -399,6 +400,8 @@ public:
     }
   }
 
+  friend struct FirstChars;
+
   size_t match(const char *text, size_t text_len, size_t &id) const {
     std::string lower_text;
     if (ignore_case_) {
@@ -513,7 +516,10 @@ struct SemanticValues : protected std::vector<std::any> {
   std::string_view sv() const { return sv_; }
 
   // Definition name
-  const std::string &name() const { return name_; }
+  const std::string &name() const {
+    static const std::string empty;
+    return name_ ? *name_ : empty;
+  }
 
   std::vector<unsigned int> tags;
 
@@ -605,7 +611,7 @@ private:
   std::string_view sv_;
   size_t choice_count_ = 0;
   size_t choice_ = 0;
-  std::string name_;
+  const std::string *name_ = nullptr;
 };
 
 /*
@@ -788,6 +794,8 @@ public:
 
   std::vector<bool> cut_stack;
 
+  bool choice_dispatch = false;
+
   const size_t def_count;
   const bool enablePackratParsing;
   std::vector<bool> cache_registered;
@@ -1024,15 +1032,25 @@ public:
 
   size_t parse_core(const char *s, size_t n, SemanticValues &vs, Context &c,
                     std::any &dt) const override {
-    size_t len = static_cast<size_t>(-1);
-
     if (!for_label_) { c.cut_stack.push_back(false); }
     auto se = scope_exit([&]() {
       if (!for_label_) { c.cut_stack.pop_back(); }
     });
 
+    auto candidates = ~static_cast<uint64_t>(0);
+    if (c.choice_dispatch && !dispatch_.empty() && n > 0) {
+      candidates = dispatch_[static_cast<unsigned char>(*s)];
+    }
+
+    size_t len = static_cast<size_t>(-1);
+
     size_t id = 0;
     for (const auto &ope : opes_) {
+      if (id < 64 && !(candidates >> id & 1)) {
+        id++;
+        continue;
+      }
+
       if (!c.cut_stack.empty()) { c.cut_stack.back() = false; }
 
       auto &chvs = c.push();
@@ -1066,6 +1084,10 @@ public:
 
   std::vector<std::shared_ptr<Ope>> opes_;
   bool for_label_ = false;
+
+  // Alternatives that can start with each byte, filled in by
+  // parser::enable_choice_dispatch(). Empty when dispatch is disabled.
+  std::vector<uint64_t> dispatch_;
 };
 
 class Repetition : public Ope {
@@ -1274,6 +1296,8 @@ public:
   void accept(Visitor &v) override;
 
 private:
+  friend struct FirstChars;
+
   bool in_range(const std::pair<char32_t, char32_t> &range, char32_t cp) const {
     if (ignore_case_) {
       auto cpl = std::tolower(cp);
@@ -1442,8 +1466,11 @@ public:
   const std::string &name() const;
   const std::string &trace_name() const;
 
+  void set_ope(const std::shared_ptr<Ope> &ope);
+
   std::shared_ptr<Ope> ope_;
   Definition *outer_;
+  bool keeps_choice_ = false;
   mutable std::once_flag trace_name_init_;
   mutable std::string trace_name_;
 
@@ -2202,6 +2229,168 @@ private:
   const std::vector<std::string> &params_;
 };
 
+struct FirstChars : public Ope::Visitor {
+  using Ope::Visitor::visit;
+
+  FirstChars(std::unordered_set<Holder *> &holders) : holders_(holders) {}
+
+  void visit(Sequence &ope) override {
+    for (auto op : ope.opes_) {
+      if (!add(*op)) { return; }
+    }
+    nullable = true;
+  }
+  void visit(PrioritizedChoice &ope) override {
+    for (auto op : ope.opes_) {
+      if (add(*op)) { nullable = true; }
+    }
+  }
+  void visit(Repetition &ope) override {
+    if (add(*ope.ope_) || ope.min_ == 0) { nullable = true; }
+  }
+  void visit(AndPredicate &) override { nullable = true; }
+  void visit(NotPredicate &) override { nullable = true; }
+  void visit(Dictionary &ope) override {
+    for (const auto &[key, _] : ope.trie_.dic_) {
+      if (key.size() == 1) { add_char(key[0], ope.trie_.ignore_case_); }
+    }
+  }
+  void visit(LiteralString &ope) override {
+    if (ope.lit_.empty()) {
+      nullable = true;
+    } else {
+      add_char(ope.lit_[0], ope.ignore_case_);
+    }
+  }
+  void visit(CharacterClass &ope) override {
+    for (char32_t cp = 0; cp < 0x80; cp++) {
+      auto found = false;
+      for (const auto &range : ope.ranges_) {
+        if (ope.in_range(range, cp)) {
+          found = true;
+          break;
+        }
+      }
+      if (found != ope.negated_) { chars.set(cp); }
+    }
+    add_multibyte();
+  }
+  void visit(Character &ope) override {
+    if (ope.ch_ < 0x80) {
+      chars.set(ope.ch_);
+    } else {
+      add_multibyte();
+    }
+  }
+  void visit(AnyCharacter &) override { chars.set(); }
+  void visit(CaptureScope &ope) override { ope.ope_->accept(*this); }
+  void visit(Capture &ope) override { ope.ope_->accept(*this); }
+  void visit(TokenBoundary &ope) override { ope.ope_->accept(*this); }
+  void visit(Ignore &ope) override { ope.ope_->accept(*this); }
+  void visit(User &) override { set_unknown(); }
+  void visit(WeakHolder &ope) override { ope.weak_.lock()->accept(*this); }
+  void visit(Holder &ope) override {
+    if (!holders_.insert(&ope).second) {
+      set_unknown();
+      return;
+    }
+    ope.ope_->accept(*this);
+    holders_.erase(&ope);
+  }
+  void visit(Reference &ope) override;
+  void visit(Whitespace &) override { set_unknown(); }
+  void visit(BackReference &) override { set_unknown(); }
+  void visit(PrecedenceClimbing &ope) override { ope.atom_->accept(*this); }
+  void visit(Recovery &) override { set_unknown(); }
+  void visit(Cut &) override { set_unknown(); }
+
+  // Bytes an operator can start with, and whether it can match without
+  // consuming one. Anything that cannot be analysed is reported as
+  // matching every byte.
+  std::bitset<256> chars;
+  bool nullable = false;
+
+private:
+  bool add(Ope &ope) {
+    FirstChars vis(holders_);
+    ope.accept(vis);
+    chars |= vis.chars;
+    return vis.nullable;
+  }
+
+  void add_char(char ch, bool ignore_case) {
+    auto byte = static_cast<unsigned char>(ch);
+    chars.set(byte);
+    if (ignore_case && byte < 0x80) {
+      chars.set(static_cast<unsigned char>(std::tolower(byte)));
+      chars.set(static_cast<unsigned char>(std::toupper(byte)));
+    }
+  }
+
+  void add_multibyte() {
+    for (size_t byte = 0x80; byte < 0x100; byte++) {
+      chars.set(byte);
+    }
+  }
+
+  void set_unknown() {
+    chars.set();
+    nullable = true;
+  }
+
+  std::unordered_set<Holder *> &holders_;
+};
+
+struct SetupChoiceDispatch : public Ope::Visitor {
+  using Ope::Visitor::visit;
+
+  void visit(Sequence &ope) override {
+    for (auto op : ope.opes_) {
+      op->accept(*this);
+    }
+  }
+  void visit(PrioritizedChoice &ope) override {
+    for (auto op : ope.opes_) {
+      op->accept(*this);
+    }
+
+    ope.dispatch_.clear();
+    if (ope.opes_.size() < 2 || ope.opes_.size() > 64) { return; }
+
+    std::vector<uint64_t> dispatch(256);
+    for (size_t id = 0; id < ope.opes_.size(); id++) {
+      std::unordered_set<Holder *> holders;
+      FirstChars vis(holders);
+      ope.opes_[id]->accept(vis);
+      if (vis.nullable) { vis.chars.set(); }
+
+      for (size_t byte = 0; byte < 256; byte++) {
+        if (vis.chars.test(byte)) { dispatch[byte] |= uint64_t(1) << id; }
+      }
+    }
+    ope.dispatch_ = std::move(dispatch);
+  }
+  void visit(Repetition &ope) override { ope.ope_->accept(*this); }
+  void visit(AndPredicate &ope) override { ope.ope_->accept(*this); }
+  void visit(NotPredicate &ope) override { ope.ope_->accept(*this); }
+  void visit(CaptureScope &ope) override { ope.ope_->accept(*this); }
+  void visit(Capture &ope) override { ope.ope_->accept(*this); }
+  void visit(TokenBoundary &ope) override { ope.ope_->accept(*this); }
+  void visit(Ignore &ope) override { ope.ope_->accept(*this); }
+  void visit(Holder &ope) override { ope.ope_->accept(*this); }
+  void visit(Reference &ope) override {
+    for (auto arg : ope.args_) {
+      arg->accept(*this);
+    }
+  }
+  void visit(Whitespace &ope) override { ope.ope_->accept(*this); }
+  void visit(PrecedenceClimbing &ope) override {
+    ope.atom_->accept(*this);
+    ope.binop_->accept(*this);
+  }
+  void visit(Recovery &ope) override { ope.ope_->accept(*this); }
+};
+
 /*
  * Keywords
  */
@@ -2237,7 +2426,7 @@ public:
   }
 
   Definition &operator<=(const std::shared_ptr<Ope> &ope) {
-    holder_->ope_ = ope;
+    holder_->set_ope(ope);
     return *this;
   }
 
@@ -2274,7 +2463,7 @@ public:
     std::any dt;
     auto r = parse_core(s, n, vs, dt, path, log);
     if (r.ret && !vs.empty() && vs.front().has_value()) {
-      val = std::any_cast<T>(vs[0]);
+      val = std::any_cast<T>(std::move(vs[0]));
     }
     return r;
   }
@@ -2293,7 +2482,7 @@ public:
     SemanticValues vs;
     auto r = parse_core(s, n, vs, dt, path, log);
     if (r.ret && !vs.empty() && vs.front().has_value()) {
-      val = std::any_cast<T>(vs[0]);
+      val = std::any_cast<T>(std::move(vs[0]));
     }
     return r;
   }
@@ -2402,6 +2591,7 @@ public:
   std::shared_ptr<Ope> whitespaceOpe;
   std::shared_ptr<Ope> wordOpe;
   bool enablePackratParsing = false;
+  bool enableChoiceDispatch = false;
   bool is_macro = false;
   std::vector<std::string> params;
   bool disable_action = false;
@@ -2438,17 +2628,37 @@ private:
                     const char *path, Log log) const {
     initialize_definition_ids();
 
-    std::shared_ptr<Ope> ope = holder_;
-
     std::any trace_data;
     if (tracer_start) { tracer_start(trace_data); }
     auto se = scope_exit([&]() {
       if (tracer_end) { tracer_end(trace_data); }
     });
 
+    // With choice dispatch the input is first parsed without tracking errors.
+    // Only if that fails is it parsed again, entering every alternative, to
+    // report exactly what a parse without dispatch would.
+    if (enableChoiceDispatch) {
+      auto dispatched_vs = vs;
+      auto r = parse_pass(s, n, dispatched_vs, dt, path, nullptr, true,
+                          trace_data);
+      if (!log || (r.ret && !r.recovered)) {
+        vs = std::move(dispatched_vs);
+        return r;
+      }
+    }
+
+    return parse_pass(s, n, vs, dt, path, log, false, trace_data);
+  }
+
+  Result parse_pass(const char *s, size_t n, SemanticValues &vs, std::any &dt,
+                    const char *path, Log log, bool choice_dispatch,
+                    std::any &trace_data) const {
+    std::shared_ptr<Ope> ope = holder_;
+
     Context c(path, s, n, definition_ids_.size(), whitespaceOpe, wordOpe,
               enablePackratParsing, tracer_enter, tracer_leave, trace_data,
               verbose_trace, log);
+    c.choice_dispatch = choice_dispatch;
 
     size_t i = 0;
 
@@ -2813,15 +3023,9 @@ inline size_t Holder::parse_core(const char *s, size_t n, SemanticValues &vs,
     // Invoke action
     if (success(len)) {
       chvs.sv_ = std::string_view(s, len);
-      chvs.name_ = outer_->name;
+      chvs.name_ = &outer_->name;
 
-      auto ope_ptr = ope_.get();
-      {
-        auto tok_ptr = dynamic_cast<const peg::TokenBoundary *>(ope_ptr);
-        if (tok_ptr) { ope_ptr = tok_ptr->ope_.get(); }
-      }
-      if (!dynamic_cast<const peg::PrioritizedChoice *>(ope_ptr) &&
-          !dynamic_cast<const peg::Dictionary *>(ope_ptr)) {
+      if (!keeps_choice_) {
         chvs.choice_count_ = 0;
         chvs.choice_ = 0;
       }
@@ -2877,6 +3081,19 @@ inline std::any Holder::reduce(SemanticValues &vs, std::any &dt) const {
 
 inline const std::string &Holder::name() const { return outer_->name; }
 
+inline void Holder::set_ope(const std::shared_ptr<Ope> &ope) {
+  ope_ = ope;
+
+  // Whether the rule reports which alternative matched is fixed by its
+  // operator, so it is resolved here rather than on every match.
+  auto ope_ptr = ope_.get();
+  if (auto tok_ptr = dynamic_cast<const peg::TokenBoundary *>(ope_ptr)) {
+    ope_ptr = tok_ptr->ope_.get();
+  }
+  keeps_choice_ = dynamic_cast<const peg::PrioritizedChoice *>(ope_ptr) ||
+                  dynamic_cast<const peg::Dictionary *>(ope_ptr);
+}
+
 inline const std::string &Holder::trace_name() const {
   std::call_once(trace_name_init_,
                  [this]() { trace_name_ = "[" + outer_->name + "]"; });
@@ -3299,6 +3516,14 @@ inline void FindReference::visit(Reference &ope) {
   found_ope = ope.shared_from_this();
 }
 
+inline void FirstChars::visit(Reference &ope) {
+  if (ope.rule_ && !ope.rule_->is_macro) {
+    ope.get_core_operator()->accept(*this);
+  } else {
+    set_unknown();
+  }
+}
+
 /*-----------------------------------------------------------------------------
  *  PEG parser generator
  *---------------------------------------------------------------------------*/
@@ -4008,7 +4233,7 @@ private:
         return false;
       }
 
-      rule.holder_->ope_ = pre(atom, binop, info, rule);
+      rule.holder_->set_ope(pre(atom, binop, info, rule));
       rule.disable_action = true;
     } catch (...) {
       if (log) {
@@ -4738,6 +4963,19 @@ public:
     }
   }
 
+  // Ordered choices only enter the alternatives that can start with the next
+  // input byte. A parse that fails is repeated without dispatch to report
+  // errors, so on invalid input actions and tracers run twice.
+  void enable_choice_dispatch() {
+    if (grammar_ != nullptr) {
+      for (auto &[_, rule] : *grammar_) {
+        SetupChoiceDispatch vis;
+        rule.accept(vis);
+      }
+      (*grammar_)[start_].enableChoiceDispatch = true;
+    }
+  }
+
   void enable_trace(TracerEnter tracer_enter, TracerLeave tracer_leave) {
     if (grammar_ != nullptr) {
       auto &rule = (*grammar_)[start_];
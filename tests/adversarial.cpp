@@ -0,0 +1,137 @@
+// Times both backends on pathological inputs of growing size. With --check
+// it fails unless every case takes time linear in the size of its input.
+//
+// Usage: adversarial [--check]
+
+#include "gd_parser.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace
+{
+	// Repeats a fragment until the input is at least size bytes long.
+	std::string fill(std::string input, std::string_view fragment, size_t size)
+	{
+		while (input.size() < size)
+		{
+			input += fragment;
+		}
+
+		return input;
+	}
+
+	struct pathology
+	{
+		std::string_view name;
+		std::string (*generate)(size_t size);
+	};
+
+	constexpr pathology pathologies[] = {
+		{ "unterminated nesting", [](size_t size) {
+			 return fill("[a]\nb = ", "[", size);
+		 } },
+		{ "balanced nesting", [](size_t size) {
+			 auto level = std::string(gd::max_depth - 1, '[') + "1" + std::string(gd::max_depth - 1, ']') + ", ";
+
+			 return fill("[a]\nb = [", level, size) + "1]\n";
+		 } },
+		{ "unterminated constructables", [](size_t size) {
+			 return fill("[a]\nb = ", "Foo(1, ", size);
+		 } },
+		{ "unclosed argument list", [](size_t size) {
+			 return fill("[a]\nb = Vector2(", "1, ", size);
+		 } },
+		{ "unclosed array", [](size_t size) {
+			 return fill("[a]\nb = [", "true, ", size);
+		 } },
+		{ "long identifier", [](size_t size) {
+			 return fill("[a]\nb = true", "e", size);
+		 } },
+		{ "almost matching identifiers", [](size_t size) {
+			 return fill("[a]\nb = [", "truest(1), false_(2), PackedInt32Arrays(3), ", size) + "1]\n";
+		 } },
+		{ "unterminated string", [](size_t size) {
+			 return fill("[a]\nb = \"", "c = [1, {\"d\": Vector2(2, 3)}]\n", size);
+		 } },
+		{ "unterminated strings", [](size_t size) {
+			 return fill("[a]\n", "b = &\"c\n", size);
+		 } },
+	};
+
+	constexpr size_t sizes[] = { 16 * 1024, 64 * 1024, 256 * 1024 };
+
+	// The best of a few runs, in nanoseconds per input byte.
+	double measure(const std::string& input, gd::backend backend)
+	{
+		auto best = std::chrono::steady_clock::duration::max();
+
+		for (auto run = 0; run < 3; run++)
+		{
+			auto start = std::chrono::steady_clock::now();
+
+			gd::parse(std::string_view(input), backend);
+
+			best = std::min(best, std::chrono::steady_clock::now() - start);
+		}
+
+		return std::chrono::duration<double, std::nano>(best).count() / input.size();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	auto check = argc > 1 && std::string_view(argv[1]) == "--check";
+
+	// Invalid input is reported on stderr, which would drown the results.
+	std::ostringstream errors;
+	auto previous = std::cerr.rdbuf(errors.rdbuf());
+
+	bool success = true;
+
+	std::cout << std::left << std::setw(30) << "input" << std::setw(20) << "backend";
+
+	for (auto size : sizes)
+	{
+		std::cout << std::right << std::setw(12) << std::to_string(size / 1024) + " KiB";
+	}
+
+	std::cout << "   (ns per byte)" << std::endl;
+
+	for (const auto& pathology : pathologies)
+	{
+		for (auto backend : { gd::backend::peg, gd::backend::recursive_descent })
+		{
+			double times[std::size(sizes)];
+
+			for (size_t i = 0; i < std::size(sizes); i++)
+			{
+				times[i] = measure(pathology.generate(sizes[i]), backend);
+			}
+
+			// The largest input is sixteen times the smallest. Linear parsing
+			// keeps the time per byte about the same, quadratic parsing would
+			// multiply it by sixteen.
+			auto linear = times[std::size(sizes) - 1] <= times[0] * 4;
+
+			std::cout << std::left << std::setw(30) << pathology.name << std::setw(20) << (backend == gd::backend::peg ? "peg" : "recursive descent") << std::right << std::fixed << std::setprecision(1);
+
+			for (auto time : times)
+			{
+				std::cout << std::setw(12) << time;
+			}
+
+			std::cout << (linear ? "" : "   not linear") << std::endl;
+
+			success = success && linear;
+		}
+	}
+
+	std::cerr.rdbuf(previous);
+
+	return !check || success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
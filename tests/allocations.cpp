@@ -0,0 +1,137 @@
+// Counts the allocations made while parsing nested values of growing depth
+// and checks that they grow linearly with the depth. Copying a value at
+// every level it passes through on its way up would make them quadratic.
+
+#include "gd_parser.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+
+namespace
+{
+	std::atomic<size_t> allocations;
+}
+
+void* operator new(std::size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+
+	if (auto memory = std::malloc(size ? size : 1))
+	{
+		return memory;
+	}
+
+	throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+namespace
+{
+	struct shape
+	{
+		std::string_view name;
+		std::string_view open;
+		std::string_view close;
+	};
+
+	constexpr shape shapes[] = {
+		{ "arrays", "[1, \"a\", ", "]" },
+		{ "dictionaries", "{\"a\": 1, \"b\": ", "}" },
+		{ "mixed", "[{\"a\": Vector2(1, 2), \"b\": Object(", ")}]" },
+	};
+
+	std::string nested(const shape& shape, size_t depth)
+	{
+		std::string input = "[node]\nvalue = ";
+
+		for (size_t level = 0; level < depth; level++)
+		{
+			input += shape.open;
+		}
+
+		input += "true";
+
+		for (size_t level = 0; level < depth; level++)
+		{
+			input += shape.close;
+		}
+
+		return input + "\n";
+	}
+
+	size_t count_allocations(const std::string& input, gd::backend backend)
+	{
+		auto before = allocations.load();
+
+		auto file = gd::parse(std::string_view(input), backend);
+
+		auto after = allocations.load();
+
+		if (file.tags.size() != 1)
+		{
+			std::cout << "failed to parse:\n" << input << std::endl;
+			std::exit(EXIT_FAILURE);
+		}
+
+		return after - before;
+	}
+}
+
+int main()
+{
+	// The mixed shape opens three brackets per level, which has to stay below
+	// gd::max_depth.
+	constexpr size_t depths[] = { 10, 20, 40, 80 };
+
+	static_assert(depths[3] * 3 < gd::max_depth);
+
+	bool success = true;
+
+	// Compile the grammar before counting.
+	gd::default_parser();
+
+	for (auto backend : { gd::backend::peg, gd::backend::recursive_descent })
+	{
+		for (const auto& shape : shapes)
+		{
+			size_t counts[std::size(depths)];
+
+			for (size_t i = 0; i < std::size(depths); i++)
+			{
+				counts[i] = count_allocations(nested(shape, depths[i]), backend);
+			}
+
+			// The last step adds four times as many levels as the first, so it
+			// adds four times as many allocations if they grow linearly and
+			// sixteen times as many if they grow quadratically.
+			auto first = counts[1] - counts[0];
+			auto last = counts[3] - counts[2];
+			auto linear = last <= first * 8;
+
+			std::cout << (backend == gd::backend::peg ? "peg" : "recursive descent") << ", " << shape.name << ":";
+
+			for (auto count : counts)
+			{
+				std::cout << " " << count;
+			}
+
+			std::cout << (linear ? "" : " (not linear)") << std::endl;
+
+			success = success && linear;
+		}
+	}
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,864 @@
+// Parses generated and mutated inputs with both backends and checks that they
+// agree: the same tree for valid input, and an error at the same line and
+// column for invalid input. Valid input is also parsed lazily with every
+// deferred value materialized, goes through the binary format, both
+// deserialized and walked with gd::binary::file_view, and through a
+// gd::parse_cache, and has to come back as the same tree each time. Parsing
+// it with a random gd::filter has to give the same tree with the tags and
+// fields that the filter does not select removed. Finally every input is
+// edited at random through a gd::incremental_file, which has to match a
+// fresh parse of the edited source after each edit. Batches of inputs are
+// written to files and parsed with gd::parse_many on several numbers of
+// threads, which has to give what gd::parse_file gives for each of them, and
+// concatenated and parsed with gd::parse_parallel, which has to give what
+// gd::parse gives.
+//
+// Usage: differential [iterations] [seed]
+
+#include "gd_parser.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+
+namespace
+{
+	// Writes a tree as text with dictionary keys sorted, so that two trees
+	// compare equal exactly when their dumps do.
+	class dumper
+	{
+	public:
+		using result = void;
+
+		explicit dumper(std::string& output)
+			: _output(output)
+		{
+		}
+
+		void dump(const gd::file& file)
+		{
+			for (const auto& tag : file.tags)
+			{
+				_output += "[" + tag.identifier;
+
+				for (const auto& field : tag.fields)
+				{
+					dump(field);
+				}
+
+				_output += "]";
+
+				for (const auto& field : tag.assignments)
+				{
+					dump(field);
+				}
+
+				_output += "\n";
+			}
+		}
+
+		void visit(const gd::constructable& constructable)
+		{
+			_output += constructable.identifier + "(";
+
+			for (const auto& argument : constructable.arguments)
+			{
+				havoc::visit(*this, argument);
+				_output += ",";
+			}
+
+			_output += ")";
+		}
+
+		void visit(const gd::dictionary_t& dictionary)
+		{
+			std::vector<const gd::dictionary_t::value_type*> properties;
+
+			for (const auto& property : dictionary)
+			{
+				properties.push_back(&property);
+			}
+
+			std::ranges::sort(properties, {}, [](auto property) { return property->first; });
+
+			_output += "{";
+
+			for (auto property : properties)
+			{
+				_output += "s" + std::to_string(property->first.size()) + ":" + property->first + ":";
+				havoc::visit(*this, property->second);
+				_output += ",";
+			}
+
+			_output += "}";
+		}
+
+		void visit(const gd::array_t& array)
+		{
+			_output += "[";
+
+			for (const auto& value : array)
+			{
+				havoc::visit(*this, value);
+				_output += ",";
+			}
+
+			_output += "]";
+		}
+
+		void visit(const gd::packed_array& packed)
+		{
+			_output += "packed " + packed.identifier + " " + std::to_string(packed.elements.index()) + "(";
+
+			auto elements = [&](const auto& values) {
+				for (auto value : values)
+				{
+					number(value);
+					_output += ",";
+				}
+			};
+
+			if (auto bytes = packed.elements.get_if<std::vector<std::uint8_t>>())
+			{
+				elements(*bytes);
+			}
+			else if (auto int32s = packed.elements.get_if<std::vector<std::int32_t>>())
+			{
+				elements(*int32s);
+			}
+			else if (auto int64s = packed.elements.get_if<std::vector<std::int64_t>>())
+			{
+				elements(*int64s);
+			}
+			else if (auto floats = packed.elements.get_if<std::vector<float>>())
+			{
+				elements(*floats);
+			}
+			else if (auto doubles = packed.elements.get_if<std::vector<double>>())
+			{
+				elements(*doubles);
+			}
+
+			_output += ")";
+		}
+
+		void visit(bool boolean)
+		{
+			_output += boolean ? "true" : "false";
+		}
+
+		void visit(const std::string& string)
+		{
+			_output += "s" + std::to_string(string.size()) + ":" + string;
+		}
+
+		void visit(std::int64_t integer)
+		{
+			_output += "i";
+			number(integer);
+		}
+
+		void visit(double real)
+		{
+			_output += "d";
+			number(real);
+		}
+
+		void visit(const gd::deferred& deferred)
+		{
+			_output += "deferred " + std::string(deferred.source);
+		}
+
+	private:
+		void dump(const gd::field& field)
+		{
+			_output += " " + field.name + "=";
+			havoc::visit(*this, field.value);
+		}
+
+		void number(auto value)
+		{
+			char buffer[64];
+
+			auto [end, error] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+
+			_output.append(buffer, end);
+		}
+
+		std::string& _output;
+	};
+
+	std::string dump(const gd::file& file)
+	{
+		std::string output;
+
+		dumper(output).dump(file);
+
+		return output;
+	}
+
+	// Builds a file from binary data through gd::binary::file_view alone.
+	gd::file rebuild(std::string_view data)
+	{
+		gd::file file;
+
+		auto fields = [](auto views, auto& fields) {
+			for (auto field : views)
+			{
+				fields.push_back({ std::string(field.name()), field.value().decode() });
+			}
+		};
+
+		for (auto view : gd::binary::file_view(data).tags())
+		{
+			auto& tag = file.tags.emplace_back();
+
+			tag.identifier = view.identifier();
+
+			fields(view.fields(), tag.fields);
+			fields(view.assignments(), tag.assignments);
+		}
+
+		return file;
+	}
+
+	// Parses with values longer than threshold bytes deferred and then
+	// materializes every one of them.
+	std::string materialized(const std::string& input, size_t threshold)
+	{
+		auto file = gd::parse_lazy(std::string_view(input), threshold);
+
+		try
+		{
+			for (auto& tag : file.tags)
+			{
+				for (auto& field : tag.fields)
+				{
+					gd::materialize(field.value);
+				}
+
+				for (auto& field : tag.assignments)
+				{
+					gd::materialize(field.value);
+				}
+			}
+		}
+		catch (const std::invalid_argument& error)
+		{
+			return error.what();
+		}
+
+		return dump(file);
+	}
+
+	// Selects a random half of the tags and fields that occur in the file,
+	// or sometimes all of them through an empty list.
+	gd::filter random_filter(const gd::file& file, std::mt19937& random)
+	{
+		gd::filter filter;
+
+		auto maybe = [&](auto& names, std::string_view name) {
+			if (random() % 2 == 0)
+			{
+				names.push_back(name);
+			}
+		};
+
+		for (const auto& tag : file.tags)
+		{
+			maybe(filter.tags, tag.identifier);
+
+			for (const auto& field : tag.fields)
+			{
+				maybe(filter.fields, field.name);
+			}
+
+			for (const auto& field : tag.assignments)
+			{
+				maybe(filter.fields, field.name);
+			}
+		}
+
+		if (random() % 4 == 0)
+		{
+			filter.tags.clear();
+		}
+
+		if (random() % 4 == 0)
+		{
+			filter.fields.clear();
+		}
+
+		return filter;
+	}
+
+	// What parse_filtered should produce: the file with every tag and field
+	// that the filter does not select removed.
+	gd::file remove_unselected(gd::file file, const gd::filter& filter)
+	{
+		std::erase_if(file.tags, [&](const auto& tag) { return !filter.selects_tag(tag.identifier); });
+
+		for (auto& tag : file.tags)
+		{
+			std::erase_if(tag.fields, [&](const auto& field) { return !filter.selects_field(field.name); });
+			std::erase_if(tag.assignments, [&](const auto& field) { return !filter.selects_field(field.name); });
+		}
+
+		return file;
+	}
+
+	// Writes the inputs to files and parses them with gd::parse_many on a few
+	// numbers of threads. Every file has to come back as gd::parse_file gives
+	// it, in the order of the paths.
+	size_t compare_many(const std::vector<std::string>& inputs, const std::filesystem::path& directory, gd::backend backend)
+	{
+		std::vector<std::filesystem::path> paths;
+
+		for (const auto& input : inputs)
+		{
+			auto& path = paths.emplace_back(directory / (std::to_string(paths.size()) + ".tscn"));
+
+			std::ofstream(path, std::ios::binary) << input;
+		}
+
+		std::ostringstream log;
+
+		auto previous = std::cerr.rdbuf(log.rdbuf());
+
+		std::vector<std::string> expected;
+
+		for (const auto& path : paths)
+		{
+			expected.push_back(dump(gd::parse_file(path, backend)));
+		}
+
+		size_t mismatches = 0;
+
+		for (auto threads : { 1, 2, 4, 8 })
+		{
+			auto files = gd::parse_many(paths, backend, threads);
+
+			for (size_t i = 0; i < files.size(); i++)
+			{
+				if (dump(files[i]) != expected[i] && mismatches++ < 10)
+				{
+					std::cout << "parse_many mismatch on " << threads << " threads:\n"
+							  << inputs[i] << "\n";
+				}
+			}
+		}
+
+		std::cerr.rdbuf(previous);
+
+		return mismatches;
+	}
+
+	// Parses the input with gd::parse_parallel on a few numbers of threads,
+	// which has to give what gd::parse gives.
+	size_t compare_parallel(const std::string& input)
+	{
+		std::ostringstream log;
+
+		auto previous = std::cerr.rdbuf(log.rdbuf());
+
+		auto expected = dump(gd::parse(std::string_view(input)));
+
+		size_t mismatches = 0;
+
+		for (auto threads : { 1, 2, 4, 8 })
+		{
+			if (dump(gd::parse_parallel(input, threads)) != expected && mismatches++ < 10)
+			{
+				std::cout << "parse_parallel mismatch on " << threads << " threads:\n"
+						  << input << "\n";
+			}
+		}
+
+		std::cerr.rdbuf(previous);
+
+		return mismatches;
+	}
+
+	struct outcome
+	{
+		std::string tree;
+		std::string error;
+	};
+
+	// The line and column of the first error the backend reported, which is
+	// all the recursive descent backend reports.
+	std::string error_position(const std::string& log)
+	{
+		auto line = log.find(':');
+
+		if (line == std::string::npos)
+		{
+			return {};
+		}
+
+		return log.substr(0, log.find(':', line + 1));
+	}
+
+	outcome parse(const std::string& input, gd::backend backend)
+	{
+		std::ostringstream log;
+
+		auto previous = std::cerr.rdbuf(log.rdbuf());
+
+		auto file = gd::parse(std::string_view(input), backend);
+
+		std::cerr.rdbuf(previous);
+
+		return { dump(file), error_position(log.str()) };
+	}
+
+	class generator
+	{
+	public:
+		explicit generator(std::uint32_t seed)
+			: _random(seed)
+		{
+		}
+
+		std::string file()
+		{
+			std::string output;
+
+			for (auto tags = between(1, 4); tags > 0; tags--)
+			{
+				output += "[" + identifier();
+
+				for (auto fields = between(0, 3); fields > 0; fields--)
+				{
+					output += " " + identifier() + "=" + value(0);
+				}
+
+				output += "]\n";
+
+				for (auto assignments = between(0, 4); assignments > 0; assignments--)
+				{
+					output += identifier() + " = " + (chance(20) ? deep() : value(0)) + "\n";
+				}
+
+				output += whitespace();
+			}
+
+			if (chance(2))
+			{
+				mutate(output);
+			}
+
+			return output;
+		}
+
+		// Text for an edit: a fragment that mostly breaks structure, a value,
+		// an assignment or a tag header.
+		std::string fragment()
+		{
+			switch (between(0, 3))
+			{
+			case 0:
+				return std::string(pick(fragments));
+			case 1:
+				return value(0);
+			case 2:
+				return identifier() + " = " + value(0) + "\n";
+			default:
+				return "[" + identifier() + "]\n";
+			}
+		}
+
+	private:
+		static constexpr std::string_view fragments[] = { "[", "]", "{", "}", "(", ")", ",", "=", ":", "\"", "&", "-", ".", "e", "1", "a", " ", "\n", "true", "Vector2(", std::string_view("\0", 1) };
+
+		static constexpr std::string_view packed_identifiers[] = {
+			"PackedByteArray",
+			"PackedInt32Array",
+			"PackedInt64Array",
+			"PackedFloat32Array",
+			"PackedFloat64Array",
+			"PackedVector2Array",
+			"PackedVector3Array",
+			"PackedVector4Array",
+			"PackedColorArray",
+			"PackedStringArray",
+		};
+
+		std::string value(int depth)
+		{
+			switch (between(0, depth < 4 ? 7 : 2))
+			{
+			case 0:
+				return number();
+			case 1:
+				return string();
+			case 2:
+				return chance(2) ? "true" : "false";
+			case 3:
+				return list("[", "]", [&] { return value(depth + 1); });
+			case 4:
+				return list("{", "}", [&] { return string() + ":" + whitespace() + value(depth + 1); });
+			case 5:
+				return identifier() + list("(", ")", [&] { return value(depth + 1); });
+			case 6:
+				return std::string(pick(packed_identifiers)) + list("(", ")", [&] { return number(); });
+			default:
+				return std::string(pick(packed_identifiers)) + list("(", ")", [&] { return value(depth + 1); });
+			}
+		}
+
+		// A value nested right around gd::max_depth.
+		std::string deep()
+		{
+			static constexpr std::pair<std::string_view, std::string_view> levels[] = {
+				{ "[", "]" },
+				{ "{\"a\": ", "}" },
+				{ "Object(", ")" },
+				{ "[1, ", "]" },
+			};
+
+			auto depth = between(gd::max_depth - 3, gd::max_depth + 2);
+
+			std::string open;
+			std::string close;
+
+			for (size_t level = 0; level < depth; level++)
+			{
+				const auto& [opening, closing] = pick(levels);
+
+				open += opening;
+				close.insert(0, closing);
+			}
+
+			return open + value(4) + close;
+		}
+
+		std::string list(std::string_view open, std::string_view close, auto element)
+		{
+			std::string output(open);
+
+			for (auto count = between(0, 4); count > 0; count--)
+			{
+				output += whitespace() + element() + whitespace();
+
+				if (count > 1)
+				{
+					output += ",";
+				}
+			}
+
+			return output + std::string(close);
+		}
+
+		std::string number()
+		{
+			static constexpr std::string_view extremes[] = {
+				"9223372036854775807",
+				"-9223372036854775808",
+				"9223372036854775808",
+				"18446744073709551616",
+				"255",
+				"256",
+				"-1",
+				"2147483648",
+				"1e400",
+				"0.0000001",
+			};
+
+			if (chance(6))
+			{
+				return std::string(pick(extremes));
+			}
+
+			std::string output = chance(4) ? "-" : "";
+
+			output += digits();
+
+			if (chance(6))
+			{
+				output += "e" + std::string(chance(3) ? "-" : "") + digits(2);
+			}
+
+			if (chance(3))
+			{
+				output += "." + digits();
+
+				if (chance(6))
+				{
+					output += "e" + digits(2);
+				}
+			}
+
+			return output;
+		}
+
+		std::string digits(int length = 6)
+		{
+			std::string output;
+
+			for (auto count = between(1, length); count > 0; count--)
+			{
+				output += static_cast<char>('0' + between(0, 9));
+			}
+
+			return output;
+		}
+
+		std::string string()
+		{
+			static constexpr std::string_view characters = "ab \n\t[]{}(),:=&.\\'";
+
+			std::string output = chance(8) ? "&\"" : "\"";
+
+			for (auto count = between(0, 8); count > 0; count--)
+			{
+				output += characters[between(0, characters.size() - 1)];
+			}
+
+			return output + "\"";
+		}
+
+		std::string identifier()
+		{
+			static constexpr std::string_view words[] = {
+				"node", "ext_resource", "gd_scene", "Vector2", "Color", "true", "false", "truest", "false_", "res://a.png", "1a", "_x", "a.b", "Transform3D",
+			};
+
+			if (chance(2))
+			{
+				return std::string(pick(words));
+			}
+
+			static constexpr std::string_view characters = "abzAZ09._:/";
+
+			std::string output;
+
+			for (auto count = between(1, 6); count > 0; count--)
+			{
+				output += characters[between(0, characters.size() - 1)];
+			}
+
+			return output;
+		}
+
+		std::string whitespace()
+		{
+			static constexpr std::string_view spaces[] = { "", "", " ", "\n", "\t", "\r\n", "  \n " };
+
+			return std::string(pick(spaces));
+		}
+
+		// Breaks the input in a few random places, mostly near structure.
+		void mutate(std::string& output)
+		{
+			for (auto count = between(1, 3); count > 0; count--)
+			{
+				auto position = between(0, output.size());
+
+				switch (between(0, 2))
+				{
+				case 0:
+					output.erase(position, between(1, 3));
+					break;
+				case 1:
+					output.insert(position, pick(fragments));
+					break;
+				default:
+					output.replace(position, 1, pick(fragments));
+					break;
+				}
+			}
+		}
+
+		size_t between(size_t low, size_t high)
+		{
+			return std::uniform_int_distribution<size_t>(low, high)(_random);
+		}
+
+		bool chance(size_t one_in)
+		{
+			return between(1, one_in) == 1;
+		}
+
+		template <typename T, size_t N>
+		const T& pick(const T (&items)[N])
+		{
+			return items[between(0, N - 1)];
+		}
+
+		std::mt19937 _random;
+	};
+}
+
+int main(int argc, char** argv)
+{
+	auto iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 5000;
+	auto seed = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1;
+
+	generator edits(seed + 1);
+	generator generator(seed);
+
+	std::mt19937 random(seed);
+
+	auto cache_directory = std::filesystem::temp_directory_path() / "gd_parser_differential_cache";
+
+	std::filesystem::remove_all(cache_directory);
+
+	gd::parse_cache cache(cache_directory);
+
+	auto many_directory = std::filesystem::temp_directory_path() / "gd_parser_differential_many";
+
+	std::filesystem::remove_all(many_directory);
+	std::filesystem::create_directories(many_directory);
+
+	std::vector<std::string> batch;
+	std::string valid;
+
+	size_t invalid = 0;
+	size_t mismatches = 0;
+
+	auto check = [&](size_t i, const std::string& input, std::string_view what, const std::string& expected, const std::string& actual) {
+		if (expected != actual && mismatches++ < 10)
+		{
+			std::cout << what << " mismatch on input " << i << ":\n"
+					  << input << "\n"
+					  << "expected: " << expected << "\n"
+					  << "actual:   " << actual << "\n";
+		}
+	};
+
+	for (size_t i = 0; i < iterations; i++)
+	{
+		auto input = generator.file();
+
+		auto peg = parse(input, gd::backend::peg);
+		auto descent = parse(input, gd::backend::recursive_descent);
+
+		// Every 64 inputs are also parsed as separate files concurrently,
+		// alternating between the backends, and concatenated into one file
+		// that is split up between threads. The valid ones are concatenated
+		// separately, since nearly every concatenation of the whole batch is
+		// invalid.
+		batch.push_back(input);
+
+		if (peg.error.empty())
+		{
+			valid += input;
+		}
+
+		if (batch.size() == 64 || i + 1 == iterations)
+		{
+			mismatches += compare_many(batch, many_directory, i / 64 % 2 ? gd::backend::recursive_descent : gd::backend::peg);
+
+			std::string all;
+
+			for (const auto& part : batch)
+			{
+				all += part;
+			}
+
+			mismatches += compare_parallel(all);
+			mismatches += compare_parallel(valid);
+
+			batch.clear();
+			valid.clear();
+		}
+
+		if (!peg.error.empty())
+		{
+			invalid++;
+		}
+
+		if (peg.tree != descent.tree || peg.error != descent.error)
+		{
+			if (mismatches++ < 10)
+			{
+				std::cout << "mismatch on input " << i << ":\n"
+						  << input << "\n"
+						  << "peg:               " << (peg.error.empty() ? peg.tree : peg.error) << "\n"
+						  << "recursive descent: " << (descent.error.empty() ? descent.tree : descent.error) << "\n";
+			}
+		}
+
+		// Edits both valid and invalid files, since an edit may fix the input
+		// as well as break it.
+		{
+			std::ostringstream log;
+
+			auto previous = std::cerr.rdbuf(log.rdbuf());
+
+			gd::incremental_file incremental(input);
+
+			for (auto count = random() % 4 + 1; count > 0; count--)
+			{
+				auto offset = random() % (incremental.source().size() + 1);
+				auto length = random() % 8;
+				auto valid = incremental.edit(offset, length, edits.fragment());
+
+				auto source = std::string(incremental.source());
+				auto fresh = parse(source, gd::backend::peg);
+
+				check(i, source, "incremental_file", fresh.tree, dump(incremental.file()));
+				check(i, source, "incremental_file validity", fresh.error.empty() ? "valid" : "invalid", valid ? "valid" : "invalid");
+			}
+
+			std::cerr.rdbuf(previous);
+		}
+
+		if (!peg.error.empty())
+		{
+			continue;
+		}
+
+		check(i, input, "materialized", peg.tree, materialized(input, i % 32));
+
+		auto file = gd::parse(std::string_view(input));
+		auto filter = random_filter(file, random);
+
+		check(i, input, "parse_filtered", dump(remove_unselected(file, filter)), dump(gd::parse_filtered(std::string_view(input), filter)));
+
+		auto data = gd::serialize(file);
+
+		check(i, input, "deserialize", peg.tree, dump(gd::deserialize(data)));
+		check(i, input, "file_view", peg.tree, dump(rebuild(data)));
+
+		// The first parse through the cache stores the entry, the second one
+		// loads it.
+		check(i, input, "parse_cache store", peg.tree, dump(cache.parse(input)));
+		check(i, input, "parse_cache load", peg.tree, dump(cache.parse(input)));
+	}
+
+	size_t entries = 0;
+
+	for (const auto& entry : std::filesystem::directory_iterator(cache.directory()))
+	{
+		if (entry.path().filename().string().find(".tmp") != std::string::npos)
+		{
+			std::cout << "temporary cache file left behind: " << entry.path() << std::endl;
+
+			mismatches++;
+		}
+
+		entries++;
+	}
+
+	if (invalid < iterations && entries == 0)
+	{
+		std::cout << "parse_cache stored nothing" << std::endl;
+
+		mismatches++;
+	}
+
+	std::filesystem::remove_all(cache_directory);
+	std::filesystem::remove_all(many_directory);
+
+	std::cout << iterations << " inputs, " << invalid << " invalid, " << mismatches << " mismatches" << std::endl;
+
+	return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
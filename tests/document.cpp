@@ -0,0 +1,96 @@
+// Moves gd::pmr::document around and checks that the tree survives the moves
+// and that every byte the document took from the default resource is given
+// back once the last document holding it is gone.
+//
+// Usage: document
+
+#include "gd_parser.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <memory_resource>
+
+namespace
+{
+	// Forwards to the new and delete resource and keeps count of the bytes
+	// that are still allocated.
+	class counting_resource : public std::pmr::memory_resource
+	{
+	public:
+		size_t outstanding = 0;
+
+	private:
+		void* do_allocate(size_t bytes, size_t alignment) override
+		{
+			outstanding += bytes;
+
+			return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+		}
+
+		void do_deallocate(void* pointer, size_t bytes, size_t alignment) override
+		{
+			outstanding -= bytes;
+
+			std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+		}
+
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+		{
+			return this == &other;
+		}
+	};
+
+	constexpr std::string_view input = R"([gd_scene load_steps=2 format=3]
+
+[node name="Root" type="Node2D"]
+position = Vector2(1, 2)
+metadata/tags = ["a", "b", { "c": [1, 2, 3] }]
+)";
+
+	bool intact(const gd::pmr::document& document)
+	{
+		return document->tags.size() == 2 && document->tags[1].assignments.size() == 2 && document->tags[1].assignments[0].name == "position";
+	}
+}
+
+int main()
+{
+	counting_resource counting;
+
+	auto previous = std::pmr::set_default_resource(&counting);
+
+	bool success = true;
+
+	{
+		auto parsed = gd::pmr::parse(input);
+
+		gd::pmr::document moved(std::move(parsed));
+
+		success = success && intact(moved);
+
+		gd::pmr::document assigned = gd::pmr::parse("[a]\n");
+
+		assigned = std::move(moved);
+
+		success = success && intact(assigned);
+
+		// Assigning to a moved-from document and moving it back must work as well.
+		moved = std::move(assigned);
+		assigned = std::move(moved);
+
+		success = success && intact(assigned);
+	}
+
+	std::pmr::set_default_resource(previous);
+
+	if (counting.outstanding != 0)
+	{
+		std::cout << counting.outstanding << " bytes not freed" << std::endl;
+
+		success = false;
+	}
+
+	std::cout << (success ? "documents survive moves" : "documents do not survive moves") << std::endl;
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
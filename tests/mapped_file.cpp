@@ -0,0 +1,57 @@
+// Maps a couple of files and moves the mappings around, checking that the
+// view follows the mapping and that the moved-from mapping is left empty.
+//
+// Usage: mapped_file
+
+#include "gd_parser.hpp"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+	std::filesystem::path write(std::string_view name, std::string_view contents)
+	{
+		auto path = std::filesystem::temp_directory_path() / name;
+
+		std::ofstream(path, std::ios::binary) << contents;
+
+		return path;
+	}
+}
+
+int main()
+{
+	auto first = write("gd_parser_mapped_file_first.tscn", "[a]\nb = 1\n");
+	auto second = write("gd_parser_mapped_file_second.tscn", "[c]\n");
+
+	bool success = true;
+
+	{
+		gd::mapped_file mapping(first);
+		gd::mapped_file moved(std::move(mapping));
+
+		success = success && mapping.view().empty() && moved.view() == "[a]\nb = 1\n";
+
+		gd::mapped_file assigned(second);
+
+		assigned = std::move(moved);
+
+		success = success && moved.view().empty() && assigned.view() == "[a]\nb = 1\n";
+
+		// Moving into an empty mapping and back again.
+		moved = std::move(assigned);
+		assigned = std::move(moved);
+
+		success = success && moved.view().empty() && gd::parse(assigned.view()).tags.size() == 1;
+	}
+
+	std::filesystem::remove(first);
+	std::filesystem::remove(second);
+
+	std::cout << (success ? "mappings survive moves" : "mappings do not survive moves") << std::endl;
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,77 @@
+// Assigns values that live inside a gd::value to that same value. The old
+// value has to stay alive until the new one has been taken out of it.
+
+#include "gd_parser.hpp"
+
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+	bool failed = false;
+
+	void expect(bool condition, const char* description)
+	{
+		if (!condition)
+		{
+			std::cout << "failed: " << description << std::endl;
+			failed = true;
+		}
+	}
+
+	gd::value nested_array()
+	{
+		gd::array_t inner { gd::value(std::string(100, 'a')), gd::value(std::int64_t(2)) };
+		gd::array_t outer { gd::value(std::move(inner)), gd::value(3.5) };
+
+		return gd::value(std::move(outer));
+	}
+}
+
+int main()
+{
+	{
+		auto value = nested_array();
+		value = std::move((*value.get_if<gd::array_t>())[0]);
+
+		auto array = value.get_if<gd::array_t>();
+		expect(array && array->size() == 2 && *(*array)[0].get_if<std::string>() == std::string(100, 'a'), "moving an element into its parent");
+	}
+
+	{
+		auto value = nested_array();
+		value = (*value.get_if<gd::array_t>())[0];
+
+		auto array = value.get_if<gd::array_t>();
+		expect(array && array->size() == 2, "copying an element into its parent");
+	}
+
+	{
+		auto value = nested_array();
+		value = std::move(*(*value.get_if<gd::array_t>())[0].get_if<gd::array_t>());
+
+		auto array = value.get_if<gd::array_t>();
+		expect(array && array->size() == 2 && (*array)[1].get_if<std::int64_t>(), "moving a nested array of the same type into its parent");
+	}
+
+	{
+		auto value = nested_array();
+		auto& inner = *(*value.get_if<gd::array_t>())[0].get_if<gd::array_t>();
+		value = *inner[0].get_if<std::string>();
+
+		expect(value.get_if<std::string>() && *value.get_if<std::string>() == std::string(100, 'a'), "copying a nested string into its parent");
+	}
+
+	{
+		gd::dictionary_t dictionary;
+		dictionary.emplace("a", gd::value(gd::dictionary_t { { "b", gd::value(true) } }));
+
+		gd::value value(std::move(dictionary));
+		value = std::move(*value.get_if<gd::dictionary_t>()->at("a").get_if<gd::dictionary_t>());
+
+		auto result = value.get_if<gd::dictionary_t>();
+		expect(result && result->size() == 1 && result->contains("b"), "moving a nested dictionary into its parent");
+	}
+
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,113 @@
+// Measures how gd::parse_many scales with the number of threads on a
+// generated project of 10,000 small scene and resource files, with both
+// backends. The files are written to a temporary directory and removed
+// afterwards.
+//
+// Usage: parse_many_scaling [max threads]
+
+#include "gd_parser.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+namespace
+{
+	constexpr size_t file_count = 10'000;
+
+	// A scene with a handful of nodes, varying in size with the index so that
+	// the threads do not all get the same amount of work.
+	std::string scene(size_t index)
+	{
+		std::string output = "[gd_scene load_steps=3 format=3 uid=\"uid://scene" + std::to_string(index) + "\"]\n\n"
+							 "[ext_resource type=\"Texture2D\" uid=\"uid://texture\" path=\"res://icon.png\" id=\"1_icon\"]\n\n"
+							 "[sub_resource type=\"RectangleShape2D\" id=\"RectangleShape2D_1\"]\n"
+							 "size = Vector2(32, 32)\n\n"
+							 "[node name=\"Root\" type=\"Node2D\"]\n\n";
+
+		for (size_t node = 0; node < 4 + index % 29; node++)
+		{
+			auto name = "Node" + std::to_string(node);
+
+			output += "[node name=\"" + name + "\" type=\"Sprite2D\" parent=\".\"]\n"
+					  "position = Vector2(" + std::to_string(node * 16) + ", " + std::to_string(index % 480) + ")\n"
+					  "texture = ExtResource(\"1_icon\")\n"
+					  "metadata/tags = [\"enemy\", \"" + name + "\", { \"health\": 100, \"speed\": 1.5 }]\n"
+					  "polygon = PackedVector2Array(0, 0, 16, 0, 16, 16, 0, 16)\n\n";
+		}
+
+		return output;
+	}
+
+	// Milliseconds for the best of a few runs.
+	double measure(std::span<const std::filesystem::path> paths, gd::backend backend, size_t threads)
+	{
+		auto best = std::chrono::steady_clock::duration::max();
+
+		for (auto run = 0; run < 3; run++)
+		{
+			auto start = std::chrono::steady_clock::now();
+
+			auto files = gd::parse_many(paths, backend, threads);
+
+			best = std::min(best, std::chrono::steady_clock::now() - start);
+
+			if (files.size() != paths.size() || files.back().tags.empty())
+			{
+				std::cout << "failed to parse" << std::endl;
+				std::exit(EXIT_FAILURE);
+			}
+		}
+
+		return std::chrono::duration<double, std::milli>(best).count();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	size_t max_threads = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : std::max(1u, std::thread::hardware_concurrency());
+
+	auto directory = std::filesystem::temp_directory_path() / "gd_parser_parse_many_scaling";
+
+	std::filesystem::remove_all(directory);
+	std::filesystem::create_directories(directory);
+
+	std::vector<std::filesystem::path> paths;
+
+	for (size_t i = 0; i < file_count; i++)
+	{
+		auto& path = paths.emplace_back(directory / ("scene" + std::to_string(i) + ".tscn"));
+
+		std::ofstream(path, std::ios::binary) << scene(i);
+	}
+
+	std::cout << std::setw(8) << "threads" << std::setw(12) << "peg" << std::setw(10) << "speedup" << std::setw(20) << "recursive descent" << std::setw(10) << "speedup" << "   (ms for " << file_count << " files)" << std::endl;
+
+	double peg_single = 0;
+	double descent_single = 0;
+
+	for (size_t threads = 1; threads <= max_threads; threads++)
+	{
+		auto peg = measure(paths, gd::backend::peg, threads);
+		auto descent = measure(paths, gd::backend::recursive_descent, threads);
+
+		if (threads == 1)
+		{
+			peg_single = peg;
+			descent_single = descent;
+		}
+
+		std::cout << std::setw(8) << threads << std::fixed << std::setprecision(1)
+				  << std::setw(12) << peg << std::setw(9) << peg_single / peg << "x"
+				  << std::setw(20) << descent << std::setw(9) << descent_single / descent << "x" << std::endl;
+	}
+
+	std::filesystem::remove_all(directory);
+
+	return EXIT_SUCCESS;
+}
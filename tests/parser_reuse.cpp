@@ -0,0 +1,78 @@
+// Measures the per-file cost of parsing small files with a freshly compiled
+// grammar for every file, which is what gd::parse used to do, and with the
+// compiled gd::parser that gd::parse now reuses. With --check it fails unless
+// reusing the parser is at least five times faster.
+//
+// Usage: parser_reuse [--check]
+
+#include "gd_parser.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace
+{
+	constexpr std::string_view small_file = R"([gd_resource type="Theme" load_steps=2 format=3 uid="uid://b7t3s5f4xs4rl"]
+
+[ext_resource type="FontFile" uid="uid://cq5dulcqhqbmi" path="res://fonts/main.ttf" id="1_font"]
+
+[resource]
+default_font = ExtResource("1_font")
+default_font_size = 18
+Button/colors/font_color = Color(0.9, 0.9, 0.9, 1)
+)";
+
+	// Nanoseconds per file for the best of a few rounds of count files.
+	double measure(size_t count, auto parse)
+	{
+		auto best = std::chrono::steady_clock::duration::max();
+
+		for (auto round = 0; round < 3; round++)
+		{
+			auto start = std::chrono::steady_clock::now();
+
+			for (size_t i = 0; i < count; i++)
+			{
+				if (parse(small_file).tags.size() != 3)
+				{
+					std::cout << "failed to parse" << std::endl;
+					std::exit(EXIT_FAILURE);
+				}
+			}
+
+			best = std::min(best, std::chrono::steady_clock::now() - start);
+		}
+
+		return std::chrono::duration<double, std::nano>(best).count() / count;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	auto check = argc > 1 && std::string_view(argv[1]) == "--check";
+
+	gd::parser reused;
+
+	auto compiled = measure(20, [](std::string_view input) {
+		return gd::parser().parse(input);
+	});
+
+	auto shared = measure(2000, [&](std::string_view input) {
+		return reused.parse(input);
+	});
+
+	auto descent = measure(2000, [&](std::string_view input) {
+		return reused.parse(input, gd::backend::recursive_descent);
+	});
+
+	std::cout << std::fixed << std::setprecision(1)
+			  << "grammar compiled per file:  " << std::setw(10) << compiled / 1000 << " us per file\n"
+			  << "compiled grammar reused:    " << std::setw(10) << shared / 1000 << " us per file\n"
+			  << "recursive descent:          " << std::setw(10) << descent / 1000 << " us per file\n"
+			  << "speedup from reuse:         " << std::setw(10) << compiled / shared << "x" << std::endl;
+
+	return !check || compiled >= shared * 5 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,94 @@
+// Measures how assigning havoc::one_of values scales across threads. Each
+// thread assigns alternatives of its own gd::value in a loop, first as
+// havoc does now, without any shared state, and then with a shared atomic
+// counter bumped on every assignment, like the timestamp havoc used to keep.
+//
+// Usage: variant_threads [max threads]
+
+#include "gd_parser.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	constexpr size_t assignments = 20'000'000;
+
+	std::atomic_uint64_t counter;
+
+	template <bool Shared>
+	void assign(size_t count, std::atomic_uint64_t& sink)
+	{
+		gd::value value;
+		std::uint64_t checksum = 0;
+
+		for (size_t i = 0; i < count; i++)
+		{
+			switch (i % 3)
+			{
+			case 0:
+				value = static_cast<std::int64_t>(i);
+				break;
+			case 1:
+				value = static_cast<double>(i);
+				break;
+			default:
+				value = (i & 8) != 0;
+				break;
+			}
+
+			if constexpr (Shared)
+			{
+				counter.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			checksum += value.index();
+		}
+
+		sink += checksum;
+	}
+
+	// Millions of assignments per second with every thread doing the same
+	// number of assignments.
+	template <bool Shared>
+	double measure(size_t threads)
+	{
+		std::atomic_uint64_t sink;
+		std::vector<std::thread> workers;
+
+		auto start = std::chrono::steady_clock::now();
+
+		for (size_t thread = 0; thread < threads; thread++)
+		{
+			workers.emplace_back(assign<Shared>, assignments / threads, std::ref(sink));
+		}
+
+		for (auto& worker : workers)
+		{
+			worker.join();
+		}
+
+		return assignments / std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	size_t max_threads = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : std::max(1u, std::thread::hardware_concurrency());
+
+	std::cout << std::setw(8) << "threads" << std::setw(16) << "no shared state" << std::setw(16) << "shared counter" << "   (million assignments per second)" << std::endl;
+
+	for (size_t threads = 1; threads <= max_threads; threads *= 2)
+	{
+		std::cout << std::setw(8) << threads << std::fixed << std::setprecision(1)
+				  << std::setw(16) << measure<false>(threads)
+				  << std::setw(16) << measure<true>(threads) << std::endl;
+	}
+
+	return EXIT_SUCCESS;
+}